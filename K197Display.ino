@@ -62,6 +62,7 @@ and naked interrupt handlers.
 #include "dxUtil.h"
 
 #include "BTmanager.h"
+#include "loopStats.h"
 
 #include "pinout.h"
 const char CH_SPACE = ' '; ///< using a global constant saves some RAM
@@ -74,6 +75,16 @@ bool msg_printout = false; ///< if true prints raw messages to DebugOut
 
 static unsigned long looptimer = 0UL; ///< keep track of loop time
 unsigned long looptimerMax = 0UL;     ///< keep track of max looptimer
+static loopWork loop_work = loop_idle; ///< what happened in this loop()
+
+/*!
+      @brief record what happened during the current loop() iteration
+      @param work what happened (the highest value is kept, see loopWork)
+*/
+static inline void loopDid(loopWork work) {
+  if (work > loop_work)
+    loop_work = work;
+}
 
 ////////////////////////////////////////////////////////////////////////////////////
 // Management of the serial user interface
@@ -88,6 +99,18 @@ void printPrompt() { // Here we want to use Serial, rather than DebugOut
   Serial.print(F(" Max loop (us): "));
   Serial.println(looptimerMax);
   looptimerMax = 0;
+  Serial.print(F(" Frames received: "));
+  Serial.println(k197dev.framesReceived());
+  Serial.print(F(" Frames dropped: "));
+  Serial.println(k197dev.framesDropped());
+  Serial.print(F(" Decode cache hits: "));
+  Serial.println(k197dev.getDecodeHits());
+  Serial.print(F(" Display update (bytes): "));
+  Serial.println(uiman.getTransferBytes());
+  Serial.print(F(" Max display slice (us): "));
+  Serial.println(uiman.getTransferTimeMax(true));
+  Serial.print(F(" Max render (us): "));
+  Serial.println(uiman.getRenderTimeMax(true));
   Serial.println(F("> "));
 }
 
@@ -101,6 +124,15 @@ void printHelp() { // Here we want to use Serial, rather than DebugOut
   Serial.println(F(" volt > show V & T"));
   Serial.println(F(" msg  > messages"));
   Serial.println(F(" log  > logging"));
+  Serial.println(F(" scr  > screen (PBM)"));
+  Serial.println(F(" loop > loop times"));
+  Serial.println(F(" llog > log loop times"));
+#ifdef PROFILE_TIMER
+  Serial.println(F(" prof > profiler"));
+#endif // PROFILE_TIMER
+#ifdef SELF_TEST
+  Serial.println(F(" test > self test"));
+#endif // SELF_TEST
 
   printPrompt();
 }
@@ -162,6 +194,20 @@ void handleSerial() { // Here we want to use Serial, rather than DebugOut
       msg_printout = true;
   } else if ((strcasecmp_P(buf, PSTR("log")) == 0)) {
     cmdLog();
+  } else if ((strcasecmp_P(buf, PSTR("scr")) == 0)) {
+    uiman.printScreen(Serial);
+  } else if ((strcasecmp_P(buf, PSTR("loop")) == 0)) {
+    loopStats.printSummary(Serial);
+  } else if ((strcasecmp_P(buf, PSTR("llog")) == 0)) {
+    loopStats.setLogEnabled(!loopStats.isLogEnabled());
+#ifdef PROFILE_TIMER
+  } else if ((strcasecmp_P(buf, PSTR("prof")) == 0)) {
+    PROFILE_summary(Serial);
+#endif // PROFILE_TIMER
+#ifdef SELF_TEST
+  } else if ((strcasecmp_P(buf, PSTR("test")) == 0)) {
+    k197dev.selfTest(Serial);
+#endif // SELF_TEST
   } else if ((strcasecmp_P(buf, PSTR(" ")) == 0)) {
     // do nothing;
   } else {
@@ -185,6 +231,7 @@ void handleSerial() { // Here we want to use Serial, rather than DebugOut
 void myButtonCallback(K197UIeventsource eventSource,
                       K197UIeventType eventType) {
   CHECK_FREE_STACK();
+  loopDid(loop_event);
   if (uiman.handleUIEvent(eventSource,
                           eventType)) { // UI related event, no need to do more
     // DebugOut.print(F("PIN=")); DebugOut.print((uint8_t) eventSource);
@@ -337,8 +384,7 @@ void loop() {
     PROFILE_start(DebugOut.PROFILE_DEVICE);
     byte n = k197dev.getNewReading(DMMReading);
     PROFILE_stop(DebugOut.PROFILE_DEVICE);
-    PROFILE_println(DebugOut.PROFILE_DEVICE,
-                    F("Time spent in getNewReading()"));
+    loopDid(loop_frame);
     if (msg_printout) {
       DebugOut.print(F("SPI - N="));
       DebugOut.print(n);
@@ -351,23 +397,19 @@ void loop() {
     }
     if (n == 9) {
       lastUpdate = looptimer;
-      PROFILE_start(DebugOut.PROFILE_DISPLAY);
       uiman.updateDisplay();
-      PROFILE_stop(DebugOut.PROFILE_DISPLAY);
-      PROFILE_println(DebugOut.PROFILE_DISPLAY, F("Time in updateDisplay()"));
-      PROFILE_start(DebugOut.PROFILE_DISPLAY);
+      loopDid(uiman.isLogging() ? loop_log : loop_render);
+      PROFILE_start(DebugOut.PROFILE_LOG);
       uiman.logData();
-      PROFILE_stop(DebugOut.PROFILE_DISPLAY);
-      PROFILE_println(DebugOut.PROFILE_DISPLAY, F("Time in logData()"));
+      PROFILE_stop(DebugOut.PROFILE_LOG);
       CHECK_FREE_STACK();
       __asm__ __volatile__("wdr" ::);
     }
-    PROFILE_start(DebugOut.PROFILE_DISPLAY);
+    PROFILE_start(DebugOut.PROFILE_BT);
     BTman.checkPresence();
     if (BTman.checkConnection() == BTmoduleTurnedOff)
       uiman.setLogging(false);
-    PROFILE_stop(DebugOut.PROFILE_DISPLAY);
-    PROFILE_println(DebugOut.PROFILE_DISPLAY, F("Time in BT checks()"));
+    PROFILE_stop(DebugOut.PROFILE_BT);
   }
   bool collision = k197dev.collisionDetected();
   if (collision != collisionStatus) {
@@ -380,10 +422,12 @@ void loop() {
     }
   }
   pushbuttons.checkNew();
+  uiman.pollDisplay(); // send the next part of the last display update
   if ((looptimer - lastUpdate) >
       (k197dev.isRCL() ? 375000l : 1000000l)) { // K197 is not updating data
     uiman.updateDisplay(false); // We still want to update the display but the
                                 // doodle should stay the same
+    loopDid(loop_render);
     lastUpdate = looptimer;
     BTman.checkPresence();
     if (BTman.checkConnection() == BTmoduleTurnedOff)
@@ -395,8 +439,10 @@ void loop() {
   }
 
   PROFILE_stop(DebugOut.PROFILE_LOOP);
-  PROFILE_println(DebugOut.PROFILE_LOOP, F("Time spent in loop()"));
   looptimer = micros() - looptimer;
   if (looptimerMax < looptimer)
     looptimerMax = looptimer;
+  loopStats.add(loop_work, looptimer);
+  loop_work = loop_idle;
+  loopStats.checkLog(millis());
 }
@@ -25,8 +25,9 @@
 /**************************************************************************/
 #include "K197device.h"
 #include <Arduino.h>
-#include <stdlib.h> // atof()
-#include <string.h> // strstr()
+#include <avr/wdt.h> // wdt_reset()
+#include <stdlib.h>  // dtostrf()
+#include <string.h>  // strstr()
 
 #include "dxUtil.h"
 
@@ -63,28 +64,6 @@ const char seg2char[128] PROGMEM = {
     '*',  'y',  'd', '&', '3', '9', 'a', '8' //  row 7 (0x70-0x7f)
 };
 
-/*!
-      @brief utility function, return the value of a string
-      @details return the value of a string skipping initial spaces
-
-      this function can only be used within K197device.cpp
-
-      @param s a null terminated char array
-      @param len the number of characters in s to consider
-
-      @return the value using atof(), or 0 if s includes only space characters
-
-*/
-float getMsgValue(char *s, int len) {
-  for (int i = 0; i < len; i++) {
-    if (*s != CH_SPACE) {
-      return atof(s);
-    }
-    s++;
-  }
-  return 0.0; // we consider a string of spaces as equivalent to 0.0
-}
-
 // ***************************************************************************************
 //  Read data from the voltmeter
 // ***************************************************************************************
@@ -147,16 +126,96 @@ bool checkMessage4overrange(const char *message) {
       If a number != 9 is returned, indicates that the data was NOT correctly
    transmitted
 
+      If more than one frame has been received since the last call (e.g.
+   because the main loop was busy), all the frames are processed in the order
+   they have been received, so that no measurement is lost in the statistics
+   and graph. Only the data from the latest frame is returned.
+
       @param data byte array that will receive the copy of the data.  MUST have
    room for at least 9 elements!
       @return the number of bytes copied into data.
 */
 byte K197device::getNewReading(byte *data) {
-  byte n = getNewData(data);
+  spi_frame_type frames[SPI_FRAME_SLOTS];
+  byte nframes = getNewData(frames, SPI_FRAME_SLOTS);
+  byte n = 0;
+  for (byte i = 0; i < nframes; i++) {
+    n = processFrame(frames[i].data, frames[i].nbyte);
+    if (n == 9)
+      updateTimestamp(frames[i].tstamp);
+  }
+  memcpy(data, frames[nframes - 1].data, PACKET_DATA);
+  CHECK_FREE_STACK();
+  return n;
+}
+
+/*!
+      @brief process a single frame received via SPI
+
+      @details this is where the actual work of getNewReading() is done. When
+   the input is stable, the K197/197A sends the same frame over and over, in
+   this case the information decoded from the previous frame is reused (see
+   isSameFrame()). Either way, statistics and graph are updated.
+
+      @param data byte array with the data received via SPI (PACKET_DATA
+   elements)
+      @param n the number of valid bytes in data
+      @return n (for convenience)
+*/
+byte K197device::processFrame(byte *data, byte n) {
   if (n != 9) {
     DebugOut.print(F("!K197 n="));
     DebugOut.println(n);
   }
+  if (isSameFrame(data, n)) {
+    decode_hits++;
+  } else {
+    decodeFrame(data, n);
+    memcpy(last_data, data, n);
+    last_n = n;
+    last_tkMode = flags.tkMode;
+    nhits_tk = 0;
+  }
+  if (n == 9) { // Avoid updating the cache if data was not read correctly
+    PROFILE_start(DebugOut.PROFILE_CACHE);
+    updateCache();
+    PROFILE_stop(DebugOut.PROFILE_CACHE);
+  }
+  return n;
+}
+
+/*!
+      @brief check if a frame is identical to the last frame that was decoded
+      @details in TK mode the frame is considered different every max_hits_tk
+   frames, to keep the cold junction compensation up to date
+      @param data byte array with the data received via SPI
+      @param n the number of valid bytes in data
+      @return true if the information decoded from the last frame can be reused
+*/
+bool K197device::isSameFrame(byte *data, byte n) {
+  if (n != last_n || flags.tkMode != last_tkMode)
+    return false;
+  if (memcmp(data, last_data, n) != 0)
+    return false;
+  if (isTKModeActive() && ++nhits_tk >= max_hits_tk)
+    return false;
+  return true;
+}
+
+/*!
+      @brief decode a single frame received via SPI
+
+      @details The numeric value is calculated directly while the segments are
+   decoded: the digits are accumulated into an integer mantissa and the number
+   of digits after the decimal point gives the power of 10. This is much faster
+   than building a string and converting it with atof(). A string is still
+   built for messages that are not numeric (e.g. overrange or CAL).
+
+      @param data byte array with the data received via SPI (PACKET_DATA
+   elements)
+      @param n the number of valid bytes in data
+*/
+void K197device::decodeFrame(byte *data, byte n) {
   if (n > 0)
     annunciators0 = data[0];
   else
@@ -182,10 +241,15 @@ byte K197device::getNewReading(byte *data) {
     message[nchar] = '-';
     nchar++;
   }
+  PROFILE_start(DebugOut.PROFILE_DECODE);
   int msg_n = n >= 7 ? 7 : n;
   byte num_dp = 0;
   flags.msg_is_num = true; // assumed true until proven otherwise
   raw_dp = 0x00;
+  long mantissa = 0;    // the digits as an integer, ignoring the decimal point
+  byte ndecimals = 0;   // number of digits after the decimal point
+  byte ndigits = 0;     // number of digits found so far
+  bool num_end = false; // true when a space is found after the first digit
   for (int i = 1; i < msg_n; i++) { // skip i=0 is done on purpose
     if (hasDecimalPoint(data[i])) {
       bitSet(raw_dp, i);
@@ -205,29 +269,70 @@ byte K197device::getNewReading(byte *data) {
                                           // to the segment combination
     raw_msg[i] = c;
     message[nchar] = c;
-    if (!isDigitOrSpace(raw_msg[i]))
+    if (isDigit(c)) {
+      if (!num_end) { // digits after a space are ignored, same as atof()
+        mantissa = mantissa * 10 + (c - '0');
+        if (num_dp != 0)
+          ndecimals++;
+      }
+      ndigits++;
+    } else if (c == CH_SPACE) {
+      if (ndigits > 0)
+        num_end = true;
+    } else {
       flags.msg_is_num = false;
+    }
     nchar++;
   }
   if (flags.msg_is_num) {
-    msg_value = getMsgValue(message, K197_MSG_SIZE);
+    if (raw_msg[0] == '-')
+      mantissa = -mantissa;
+    // a string of spaces is equivalent to 0.0
+    msg_value.setValue(mantissa, -ndecimals);
     flags.msg_is_ovrange = false;
   } else {
     // DebugOut.print(F("message=<")); DebugOut.print(message);
     // DebugOut.println(F(">"));
     flags.msg_is_ovrange = checkMessage4overrange(message);
-    msg_value = 0.0;
+    msg_value.setValue(0L, 0);
     if (strncmp_P(message, PSTR(" CAL"), 4) == 0) {
       annunciators8 |= K197_Cal_bm;
       // DebugOut.println(F(" CAL found!"));
     }
   }
+  PROFILE_stop(DebugOut.PROFILE_DECODE);
+  updateUnit();
   if (isTKModeActive() && flags.msg_is_num) {
     tkConvertV2C();
   }
-  if (n == 9)
-    updateCache(); // Avoid updating the cache if data was not read correctly
-  return n;
+}
+
+/*!
+    @brief  update the time stamp and the measured K197 update period
+    @details the update period is a rolling average of the time between
+   consecutive frames. The K197 period is fixed (within a few %), so intervals
+   longer than 1.5 times the average are not considered: they are caused by
+   lost frames or by the K197 not sending data (e.g. in RCL mode). If
+   max_tperiod_rejects intervals in a row are not considered, the period has
+   really changed (or the average started far from it) and the average is
+   restarted from the last interval. The first frame has no previous time
+   stamp and is not considered either
+    @param new_tstamp the time stamp of the latest frame
+*/
+void K197device::updateTimestamp(unsigned long new_tstamp) {
+  unsigned long delta = new_tstamp - tstamp;
+  bool first = tstamp == 0UL;
+  tstamp = new_tstamp;
+  if (first)
+    return;
+  if (delta * 16 * 2 < (unsigned long)tperiod16 * 3) {
+    int16_t diff = int16_t(delta * 16) - tperiod16;
+    tperiod16 += diff / 8;
+    tperiod_rejects = 0;
+  } else if (++tperiod_rejects >= max_tperiod_rejects) {
+    tperiod16 = delta < 0x7fff / 16 ? int16_t(delta * 16) : 0x7fff;
+    tperiod_rejects = 0;
+  }
 }
 
 /*!
@@ -241,13 +346,14 @@ void K197device::tkConvertV2C() {
   if (isOvrange() || (!isTKModeActive()))
     return;
   tcold = dxUtil.getTCelsius();
-  float t = msg_value * 24.2271538 + tcold; // msg_value = mV
-  if (t > 2200.0) {                         // Way more than needed...
+  float t = msg_value.getValue() * 24.2271538 + tcold; // msg_value = mV
+  if (t > 2200.0) { // Way more than needed...
     setOverrange();
     raw_dp = 0x00;
     return;
   }
-  msg_value = t;
+  msg_value.setValue(t < 0.0 ? long(t * 100.0 - 0.5) : long(t * 100.0 + 0.5),
+                     -2); // same resolution as the displayed value
   char message[K197_MSG_SIZE];
   dtostrf(t, K197_MSG_SIZE - 1, 2, message);
   int j = 0;
@@ -283,110 +389,67 @@ void K197device::setOverrange() {
 //  Handling of mesurement units (V, A, etc.)
 // ***************************************************************************************
 
+const char unit_none[] PROGMEM = "  "; ///< no unit
+const char unit_dB[] PROGMEM = "dB";   ///< dB
+const char unit_V[] PROGMEM = " V";    ///< Volt
+const char unit_mV[] PROGMEM = "mV";   ///< milliVolt
+const char unit_C[] PROGMEM = "°C";    ///< Celsius degrees (TK mode)
+const char unit_Ohm[] PROGMEM = " Ω";  ///< Ohm
+const char unit_kOhm[] PROGMEM = "kΩ"; ///< kiloOhm
+const char unit_MOhm[] PROGMEM = "MΩ"; ///< MegaOhm
+const char unit_A[] PROGMEM = " A";    ///< Ampere
+const char unit_mA[] PROGMEM = "mA";   ///< milliAmpere
+const char unit_uA[] PROGMEM = "µA";   ///< microAmpere
+
 /*!
-    @brief  return the unit, including SI prefix (V, mV, etc.)
-    @param include_dB if true, returns "dB" as a unit when in dB mode
-    @param hold if true returns the value at the time hold mode was last entered
-    @return the unit (2 characters + terminating NUL). This is a UTF-8 string
-   because it may include Ω or µ
+    @brief Lookup table with the information for each unit
+    @details the table is organized in rows of 3 elements, one row for each
+   main unit: no unit/dB, V, Ω, A. See updateUnit() for the index calculation.
+   canBeNegative is true if the value can be negative in DC mode without REL
 */
-const __FlashStringHelper *
-K197device::getUnit(bool include_dB,
-                    bool hold) { // Note: includes UTF-8 characters
-  if (hold) {
-    return include_dB ? cache.hold.unit_with_db : cache.hold.unit;
-  }
-  if (isV()) { // Voltage units
-    if (flags.tkMode && ismV() && isDC())
-      return F("°C");
-    else if (ismV())
-      return F("mV");
-    else
-      return F(" V");
-  } else if (isOmega()) { // Resistence units
-    if (isM())
-      return F("MΩ");
-    else if (isk())
-      return F("kΩ");
-    else
-      return F(" Ω");
-  } else if (isA()) { // Current units
-    if (ismicro())
-      return F("µA");
-    else if (ismA())
-      return F("mA");
-    else
-      return F(" A");
-  } else { // No unit found
-    if (include_dB && isdB())
-      return F("dB");
-    else
-      return F("  ");
-  }
-}
-
-/*!
-    @brief returns the main unit
-    @details this is not intended for external presentation, only for internal
-   housekeeping
-    @ the supported units are: 'C' (°C), 'V' (Volt), 'O' (Ohm), 'A' (Ampere),
-   'B' (dB) and ' ' (unrecognized unit)
-    @returns a char corresponding to the main unit
-*/
-char K197device::getMainUnit() {
-  if (isV()) { // Voltage or Temperature
-    if (flags.tkMode && ismV() && isDC())
-      return 'C';
-    else
-      return 'V';
-  } else if (isOmega()) { // Resistence
-    return 'O';
-  } else if (isA()) { // Current
-    return 'A';
-  } else if (isdB()) { // dB
-    return 'B';
-  } else { // No unit found
-    return ' ';
-  }
-}
+const K197device::k197_unit_type unitTable[] PROGMEM = {
+    {unit_none, ' ', 0, true},  // row 0: no unit found
+    {unit_dB, 'B', 0, true},    //        dB
+    {unit_none, ' ', 0, true},  //        (not used)
+    {unit_V, 'V', 0, true},     // row 1: voltage units
+    {unit_mV, 'V', -3, true},   //
+    {unit_C, 'C', 0, true},     //        temperature (TK mode)
+    {unit_Ohm, 'O', 0, false},  // row 2: resistance units
+    {unit_kOhm, 'O', 3, false}, //
+    {unit_MOhm, 'O', 6, false}, //
+    {unit_A, 'A', 0, true},     // row 3: current units
+    {unit_mA, 'A', -3, true},   //
+    {unit_uA, 'A', -6, true},   //
+};
 
 /*!
-    @brief returns the exponent corresponding to the SI multiplier
-    @details 10 elevated to the exponent returned gives the power of 10
-   corresponding to the prefix set in the annouciators For example, 1KΩ means
-   10^3Ω ==> exponent is 3. In 1µA means 10^-6A exponent is -6. with no prefix 0
-   is returned (10^0=1).
-    @param hold if true returns the value at the time hold mode was last entered
-    @returns the exponent corresponding to the SI multiplier
+    @brief  decode the unit information from the annunciators
+    @details this is done once for every new frame (and when the TK mode is
+   changed), so that getUnit(), getMainUnit(), getUnitPow10() and
+   valueCanBeNegative() just need to return the stored information.
+
+   The table index is not calculated directly from the annunciator bits: the
+   main unit bits are spread over two bytes and the prefix bits have a
+   different meaning for each unit, so a bit-indexed table would need 64 rows
+   (mostly impossible combinations) or the same tests done here. These are at
+   most six bit tests, once per frame
 */
-int8_t K197device::getUnitPow10(bool hold) {
-  if (hold) {
-    return cache.hold.pow10;
-  }
+void K197device::updateUnit() {
+  byte idx;
   if (isV()) { // Voltage units
-    if (flags.tkMode && ismV() && isDC())
-      return 0;
-    else if (ismV())
-      return -3;
-    else
-      return 0;
+    idx = 3 + ((flags.tkMode && ismV() && isDC()) ? 2 : ismV());
   } else if (isOmega()) { // Resistence units
-    if (isM())
-      return 6;
-    else if (isk())
-      return 3;
-    else
-      return 0;
+    idx = 6 + (isM() ? 2 : isk());
   } else if (isA()) { // Current units
-    if (ismicro())
-      return -6;
-    else if (ismA())
-      return -3;
-    else
-      return 0;
-  } else { // dB or no unit found
-    return 0;
+    idx = 9 + (ismicro() ? 2 : ismA());
+  } else { // No unit found
+    idx = isdB();
   }
+  memcpy_P(&unit_desc, &unitTable[idx], sizeof(k197_unit_type));
+  if (isREL())
+    unit_desc.canBeNegative = true; // Relative values can always be negative
+  else if (isAC())
+    unit_desc.canBeNegative = false; // AC cannot be negative (unless REL)
 }
 
 // ***************************************************************************************
@@ -401,7 +464,7 @@ void K197device::debugPrint() {
   DebugOut.print(raw_msg);
   if (flags.msg_is_num) {
     DebugOut.print(F(", ("));
-    DebugOut.print(msg_value, 6);
+    DebugOut.print(msg_value.getValue(), 6);
     DebugOut.print(')');
   } else {
     for (int i = 0; i < K197_RAW_MSG_SIZE; i++) {
@@ -435,9 +498,16 @@ void K197device::setDisplayHold(bool newValue) {
     cache.hold.annunciators0 = annunciators0;
     cache.hold.msg_value = msg_value;
     cache.hold.tcold = tcold;
+    cache.hold.tstamp = tstamp;
+    cache.hold.tperiod16 = tperiod16;
+    cache.hold.val_pow10 = cache.val_pow10;
     cache.hold.average = cache.average;
     cache.hold.min = cache.min;
     cache.hold.max = cache.max;
+    cache.hold.stat_n = cache.stat_n;
+    cache.hold.stat_ref = cache.stat_ref;
+    cache.hold.stat_mean = cache.stat_mean;
+    cache.hold.stat_m2 = cache.stat_m2;
     cache.hold.unit = getUnit();
     cache.hold.munit = cache.munit;
     cache.hold.unit_with_db = getUnit(true);
@@ -445,11 +515,12 @@ void K197device::setDisplayHold(bool newValue) {
     cache.hold.isTKModeActive = isTKModeActive();
     cache.hold.isNumeric = flags.msg_is_num;
 
-    // copy current graph data to cache.hold
-    cache.hold.graph.copy(&(cache.graph));
+    // freeze the current graph data (copied only when overwritten)
+    cache.hold.graph.freeze(&cache.graph);
     cache.hold.nsamples_graph = cache.nsamples_graph;
     digitalWriteFast(LED_BUILTIN, HIGH);
   } else {
+    cache.hold.graph.release();
     digitalWriteFast(LED_BUILTIN, LOW);
   }
   flags.hold = newValue;
@@ -471,41 +542,6 @@ static inline bool change0(byte b1, byte b2) {
          (b2 & (~(K197_MINUS_bm | K197_BAT_bm | K197_AUTO_bm)));
 }
 
-/*!
-    @brief  utility function, get the conversion factor between measurement unit
-   prefixes
-    @details the input should be limited to what is visualized by the K197: -6,
-   -3, 0, 3, 6 furthermore, -6 < (pow10_old-pow10_new) < +6 (nothing else is
-   possible with the K197)
-    @param pow10_old old power of 10 (what would have been returned by
-   getUnitPow10())
-    @param pow10_new new power of 10 (what is returned by getUnitPow10())
-    @return the factor that when multiplied for a value expressed in old pow10
-   returns the same value expressed with new pow10
- */
-float getPrefixConversionFactor(int8_t pow10_old, int8_t pow10_new) {
-  float fconv;
-  int8_t pow10 = pow10_old - pow10_new;
-  switch (pow10) {
-  case -6:
-    fconv = 0.000001;
-    break;
-  case -3:
-    fconv = 0.001;
-    break;
-  case 3:
-    fconv = 1000.0;
-    break;
-  case 6:
-    fconv = 1000000.0;
-    break;
-  default:
-    fconv = 1.0;
-    break;
-  }
-  return fconv;
-}
-
 /*!
     @brief  check if cached data is invalid
     @details check if cached data is invalid because the
@@ -546,6 +582,7 @@ void K197device::updateCache() {
     return; // No point updating statistics or graph now
   char munit = getMainUnit();
   int8_t pow10 = getUnitPow10();
+  long x; // msg_value expressed as a multiple of 10^cache.val_pow10
 
   if (isCacheInvalid(munit,
                      pow10)) { // Something important changed, reset stats
@@ -556,24 +593,42 @@ void K197device::updateCache() {
       if (cache.nskip_graph !=
           0) { // We do our best to keep up with the sampling rate
         if (++cache.nskip_graph >=
-            cache.nsamples_graph) // Step the counter anyway
+            cache.nsamples_graph) { // Step the counter anyway
           cache.nskip_graph = 0;
+          cache.flushBox(); // The group being averaged (if any) ends here
+        }
       }
       return; // Return without updating statistics/graph
     }
     resetStatistics();
+    x = cache.average;
   } else {
     cache.numInvalid = 0; // reset counter for next time
     if (cache.pow10 != pow10) {
-      rescaleStatistics(getPrefixConversionFactor(cache.pow10, pow10));
+      rescaleStatistics(cache.pow10 - pow10);
     }
-    cache.average += (msg_value - cache.average) *
-                     cache.avg_factor; // This not perfect but good enough
-                                       // in most practical cases.
-    if (msg_value < cache.min)
-      cache.min = msg_value;
-    if (msg_value > cache.max)
-      cache.max = msg_value;
+    x = cache.alignValue(msg_value);
+    if (cache.nsamples > 1) { // Rolling average, the remainder of the integer
+                              // division is carried over to the next sample
+      long delta = x - cache.average + cache.avg_rem;
+      long q = delta / cache.nsamples;
+      cache.avg_rem = delta - q * cache.nsamples;
+      cache.average += q;
+    } else {
+      cache.average = x;
+    }
+    if (x < cache.min)
+      cache.min = x;
+    if (x > cache.max)
+      cache.max = x;
+    // Welford's algorithm for mean and variance. The mantissas can be up to
+    // 9 digits, more than a float can hold, so the samples are accumulated
+    // as (exact) offsets from the first sample
+    long dx = x - cache.stat_ref;
+    cache.stat_n++;
+    float delta = dx - cache.stat_mean;
+    cache.stat_mean += delta / cache.stat_n;
+    cache.stat_m2 += delta * (dx - cache.stat_mean);
   }
   cache.msg_value = msg_value;
   cache.tkMode = flags.tkMode;
@@ -597,7 +652,7 @@ void K197device::updateCache() {
       }
     }
   }
-  cache.add2graph(msg_value);
+  cache.add2graph(x);
   CHECK_FREE_STACK();
 }
 
@@ -606,23 +661,110 @@ void K197device::updateCache() {
     @details average, max and min are reset, then resetGraph is invoked
  */
 void K197device::resetStatistics() {
-  cache.average = msg_value;
-  cache.min = msg_value;
-  cache.max = msg_value;
+  cache.val_pow10 = msg_value.pow10;
+  cache.average = msg_value.mant;
+  cache.avg_rem = 0;
+  cache.min = msg_value.mant;
+  cache.max = msg_value.mant;
+  cache.stat_n = 1UL;
+  cache.stat_ref = msg_value.mant;
+  cache.stat_mean = 0.0;
+  cache.stat_m2 = 0.0;
   cache.resetGraph();
 }
 
+/*!
+    @brief  returns the variance of all the samples
+    @details this is the sample variance (calculated with n-1), see also
+   getMean()
+    @param hold if true returns the value at the time hold mode was last entered
+    @return the variance (0.0 if less than two samples are available)
+ */
+float K197device::getVariance(bool hold) {
+  k197_cache_struct::k197_cache_hold_struct *h = &cache.hold;
+  unsigned long n = hold ? h->stat_n : cache.stat_n;
+  if (n < 2)
+    return 0.0;
+  float m2 = hold ? h->stat_m2 : cache.stat_m2;
+  int8_t val_pow10 = hold ? h->val_pow10 : cache.val_pow10;
+  return k197_value_type::toFloat(m2 / (n - 1), val_pow10 * 2);
+}
+
+/*!
+    @brief  returns the standard deviation of all the samples
+    @details see getVariance()
+    @param hold if true returns the value at the time hold mode was last entered
+    @return the standard deviation (0.0 if less than two samples are available)
+ */
+float K197device::getStdDev(bool hold) {
+  k197_cache_struct::k197_cache_hold_struct *h = &cache.hold;
+  unsigned long n = hold ? h->stat_n : cache.stat_n;
+  if (n < 2)
+    return 0.0;
+  float m2 = hold ? h->stat_m2 : cache.stat_m2;
+  int8_t val_pow10 = hold ? h->val_pow10 : cache.val_pow10;
+  return k197_value_type::toFloat(sqrt(m2 / (n - 1)), val_pow10);
+}
+
 /*!
     @brief  rescale all statistics (min, average, max) & graph data
-    @details average, max and min are multiplied by fconv
-    then graph.rescale(fconv) is invoked
-    @param fconv the
+    @details used when the unit prefix changes. average, max, min and graph
+   data are multiplied by 10^dpow10. Since all the values share the same power
+   of 10 (cache.val_pow10), this is exact and it does not modify any data
+    @param dpow10 the power of 10 to apply, e.g. 3 when changing from V to mV
+ */
+void K197device::rescaleStatistics(int8_t dpow10) { cache.val_pow10 += dpow10; }
+
+/*!
+    @brief  express a value as a multiple of 10^val_pow10
+    @details if needed, the power of 10 used for statistics and graph data is
+   changed first (see setValPow10()). The smallest power of 10 is selected
+   that can represent both the new value and the data already stored without
+   overflow (see k197_value_type::max_mant). Min and max are used to check
+   the stored data, as average and graph values are always in between.
+    @param v the value to convert
+    @return the mantissa of v when the power of 10 is val_pow10
+ */
+long K197device::k197_cache_struct::alignValue(k197_value_type v) {
+  if (v.pow10 == val_pow10) // this is by far the most common case
+    return v.mant;
+  long maxabs = labs(min) > labs(max) ? labs(min) : labs(max);
+  int8_t new_pow10 = v.pow10 < val_pow10 ? v.pow10 : val_pow10;
+  while (!k197_value_type::canScale(maxabs, val_pow10 - new_pow10) ||
+         !k197_value_type::canScale(v.mant, v.pow10 - new_pow10)) {
+    new_pow10++;
+  }
+  if (new_pow10 != val_pow10)
+    setValPow10(new_pow10);
+  return k197_value_type::scale(v.mant, v.pow10 - new_pow10);
+}
+
+/*!
+    @brief  change the power of 10 used for statistics and graph data
+    @details all values are converted, when the power of 10 increases they are
+   rounded to the nearest integer
+    @param new_pow10 the new power of 10
  */
-void K197device::rescaleStatistics(float fconv) {
-  cache.average *= fconv;
-  cache.min *= fconv;
-  cache.max *= fconv;
-  cache.graph.rescale(fconv);
+void K197device::k197_cache_struct::setValPow10(int8_t new_pow10) {
+  int8_t k = val_pow10 - new_pow10;
+  average = k197_value_type::scale(average, k);
+  avg_rem = 0;
+  min = k197_value_type::scale(min, k);
+  max = k197_value_type::scale(max, k);
+  long ref = k197_value_type::scale(stat_ref, k);
+  long err = 0L; // rounding error of stat_ref, added to stat_mean
+  if (k < 0)
+    err = ref == 0 ? stat_ref : stat_ref - k197_value_type::scale(ref, -k);
+  stat_ref = ref;
+  stat_mean = k197_value_type::toFloat(stat_mean + err, k);
+  stat_m2 = k197_value_type::toFloat(stat_m2, k * 2);
+  graph.rescale(k);
+  graph_pyramid.rescale(k);
+  box_ref = k197_value_type::scale(box_ref, k);
+  box_sum = k197_value_type::toFloat(box_sum, k);
+  box_min = k197_value_type::scale(box_min, k);
+  box_max = k197_value_type::scale(box_max, k);
+  val_pow10 = new_pow10;
 }
 
 // ***************************************************************************************
@@ -634,10 +776,68 @@ void K197device::rescaleStatistics(float fconv) {
 */
 void K197device::k197_cache_struct::resetGraph() {
   graph.clear();
+  graph_pyramid.clear();
   nskip_graph = 0x00;
+  box_n = 0;
   if (autosample_graph) { // if autosample is set then...
     nsamples_graph = 0;   // set fastest sampling period
+    graph_period = 0;
+  }
+}
+
+const long scaleFactorLong[] PROGMEM = {
+    1L,      10L,      100L,      1000L,      10000L,
+    100000L, 1000000L, 10000000L, 100000000L, 1000000000L}; ///< helper array
+
+/*!
+ @brief convert a mantissa and power of 10 to float
+ @param x the mantissa
+ @param p the power of 10
+ @return the value x * 10^p
+*/
+float k197_value_type::toFloat(float x, int8_t p) {
+  while (p > 6) {
+    x *= 1E6;
+    p -= 6;
+  }
+  while (p < -6) {
+    x /= 1E6;
+    p += 6;
   }
+  // divide rather than multiply with negative p, the result is more accurate
+  return p < 0 ? x / k197graph_label_type::getpow10(-p)
+               : x * k197graph_label_type::getpow10(p);
+}
+
+/*!
+ @brief multiply a mantissa by a power of 10
+ @details with k < 0 the result is rounded to the nearest integer. With k > 0
+ the caller must make sure there is no overflow (see canScale())
+ @param m the mantissa
+ @param k the power of 10
+ @return m * 10^k
+*/
+long k197_value_type::scale(long m, int8_t k) {
+  if (k >= 0)
+    return m * long(pgm_read_dword(&scaleFactorLong[k]));
+  if (k < -9)
+    return 0L;
+  long d = pgm_read_dword(&scaleFactorLong[-k]);
+  return m >= 0 ? (m + d / 2) / d : (m - d / 2) / d;
+}
+
+/*!
+ @brief check if a mantissa can be multiplied by a power of 10
+ @param m the mantissa
+ @param k the power of 10
+ @return true if the absolute value of m * 10^k is not more than max_mant
+*/
+bool k197_value_type::canScale(long m, int8_t k) {
+  if (k <= 0)
+    return true;
+  if (k > 9)
+    return m == 0;
+  return labs(m) <= max_mant / long(pgm_read_dword(&scaleFactorLong[k]));
 }
 
 const float scaleFactor[] PROGMEM = {
@@ -848,6 +1048,26 @@ void k197_display_graph_type::setScale(
   })
 }
 
+/*!
+ @brief convert a graph value to a pixel coordinate
+ @param y the value (mantissa)
+ @param ymin_m the value corresponding to pixel 0 (mantissa)
+ @param scale_factor_m pixels per unit of the mantissa
+ @param y_size the size of the graph area (max pixel coordinate)
+ @return the pixel coordinate
+*/
+static byte toPixel(long y, float ymin_m, float scale_factor_m, byte y_size) {
+  float point = (y - ymin_m) * scale_factor_m + 0.5;
+  if (point < 0.0)
+    return 0;
+  if (point > y_size) { // Can only be to bugs or rounding...
+    // force within display area, otherwise u8g2 would slow down hence data
+    // loss, etc. etc.
+    return y_size;
+  }
+  return point;
+}
+
 /*!
  @brief fills a k197_display_graph_type data structure with the values currently
  stored in the cache
@@ -856,20 +1076,71 @@ void k197_display_graph_type::setScale(
  numbers from the voltmeter stored in the cache into integer values representing
  the coordinates of the pixels in the oled display, together with other
  information that is needed to display the graph (e.g. the axis labels)
+ With level > 0 the average of each bucket in graph_pyramid is shown instead
+ of the graph, using k197_graph_pyramid_type::factor points for each bucket.
+ There is no graph_pyramid for the hold data, so level is ignored in hold mode.
+ With envelope = true point[] is filled with the max of the envelope of each
+ value and point_low[] with the min (see k197_stored_graph_type).
+ graphdata is expected to hold the data of the previous frame: the y scale is
+ only calculated again when the data does not fit anymore, or when it shrinks
+ below half of the range it had when the scale was set. When the scale did not
+ change and values have only been appended to the graph, only the new points
+ (and the newest old point) are calculated, see first_changed and num_removed.
  @param graphdata pointer to the data structure to fill
  @param yopt the required options for the scale
  @param hold if true returns the value at the time hold mode was last entered
+ @param level 0 for the graph, n for level n-1 of graph_pyramid
+ @param envelope if true fill the envelope rather than the values
 */
 void K197device::fillGraphDisplayData(k197_display_graph_type *graphdata,
-                                      k197graph_yscale_opt yopt, bool hold) {
-  k197_stored_graph_type *graph = hold ? &cache.hold.graph : &cache.graph;
-  byte gr_size = graph->getSize();
+                                      k197graph_yscale_opt yopt, bool hold,
+                                      byte level, bool envelope) {
+  k197_stored_graph_type *graph = &cache.graph;
+  k197_graph_snapshot_type *frozen = &cache.hold.graph;
+  k197_graph_pyramid_type *pyramid = &cache.graph_pyramid;
+  if (hold || level > k197_graph_pyramid_type::levels)
+    level = 0;
+  byte l = level - 1; // the pyramid level (only used if level > 0)
+  byte width = level > 0 ? k197_graph_pyramid_type::factor : 1;
+  byte gr_size;
+
+  int8_t val_pow10 = hold ? cache.hold.val_pow10 : cache.val_pow10;
 
   // find max and min in the data set
-  float grmin = graph->calcMin();
-  float grmax = graph->calcMax();
-
-  graphdata->setScale(grmin, grmax, yopt, k197dev.valueCanBeNegative(hold));
+  long ymin_raw, ymax_raw;
+  if (level > 0) {
+    gr_size = pyramid->getSize(l);
+    ymin_raw = pyramid->calcMin(l);
+    ymax_raw = pyramid->calcMax(l);
+  } else if (hold) {
+    gr_size = frozen->getSize();
+    ymin_raw = envelope ? frozen->calcEnvelopeMin() : frozen->calcMin();
+    ymax_raw = envelope ? frozen->calcEnvelopeMax() : frozen->calcMax();
+  } else {
+    gr_size = graph->getSize();
+    ymin_raw = envelope ? graph->calcEnvelopeMin() : graph->calcMin();
+    ymax_raw = envelope ? graph->calcEnvelopeMax() : graph->calcMax();
+  }
+  float grmin = k197_value_type::toFloat(ymin_raw, val_pow10);
+  float grmax = k197_value_type::toFloat(ymax_raw, val_pow10);
+
+  // The scale of the previous frame is kept if all the data still fits and
+  // the data did not shrink too much (hysteresis)
+  bool canBeNegative = k197dev.valueCanBeNegative(hold);
+  bool same_source = graphdata->valid && graphdata->hold == hold &&
+                     graphdata->level == level &&
+                     graphdata->envelope == envelope &&
+                     graphdata->yopt == yopt &&
+                     graphdata->canBeNegative == canBeNegative &&
+                     graphdata->val_pow10 == val_pow10;
+  bool rescaled = false;
+  if (!same_source || grmin < graphdata->y0.getValue() ||
+      grmax > graphdata->y1.getValue() ||
+      grmax - grmin < graphdata->span * 0.5) {
+    graphdata->setScale(grmin, grmax, yopt, canBeNegative);
+    graphdata->span = grmax - grmin;
+    rescaled = true;
+  }
   float ymin = graphdata->y0.getValue();
   float ymax = graphdata->y1.getValue();
   RT_ASSERT_ADD_STATEMENTS(bool runAgain = false;)
@@ -882,20 +1153,56 @@ void K197device::fillGraphDisplayData(k197_display_graph_type *graphdata,
   RT_ASSERT_ADD_STATEMENTS(
       if (runAgain) { graphdata->setScale(grmin, grmax, yopt, true); })
   float scale_factor = float(graphdata->y_size) / (ymax - ymin);
+  // the same, for the mantissas stored in the graph
+  float fpow10 = k197_value_type::toFloat(1.0, val_pow10);
+  float ymin_m = ymin / fpow10;
+  float scale_factor_m = scale_factor * fpow10;
+
+  // With the same scale and only new values appended to the graph, the old
+  // points are shifted rather than calculated again
+  int first = 0; // the first point to calculate
+  byte num_removed = 0;
+  uint16_t num_appended = graph->getAppendCount();
+  uint16_t num_changed = graph->getChangeCount();
+  if (same_source && !rescaled && level == 0 && !hold &&
+      num_changed == graphdata->num_changed) {
+    uint16_t num_new = num_appended - graphdata->num_appended;
+    if (num_new < gr_size) {
+      num_removed = graphdata->gr_size + num_new - gr_size;
+      byte num_kept = graphdata->gr_size - num_removed;
+      memmove(graphdata->point, graphdata->point + num_removed, num_kept);
+      memmove(graphdata->point_low, graphdata->point_low + num_removed,
+              num_kept);
+      // the envelope of the newest old value can be extended after append()
+      first = num_kept - 1;
+    }
+  }
 
-  for (int i = 0; i < gr_size; i++) {
-    RT_ASSERT(i < graphdata->x_size, "!fg2a");
-    if (i >= graphdata->x_size) {
-      break; // protect from mem. corruption, only in case of a bug!
+  int n = first * width; // index in graphdata->point
+  for (int i = first; i < gr_size; i++) {
+    long y;     // the value, or the max of the envelope
+    long y_low; // the min of the envelope
+    if (level > 0) {
+      y = envelope ? pyramid->getMax(l, i) : pyramid->getAvg(l, i);
+      y_low = pyramid->getMin(l, i);
+    } else if (hold) {
+      y = envelope ? frozen->getEnvelope(i, true) : frozen->get(i);
+      y_low = frozen->getEnvelope(i, false);
+    } else {
+      y = envelope ? graph->getEnvelope(i, true) : graph->get(i);
+      y_low = graph->getEnvelope(i, false);
     }
-    RT_ASSERT(i < graph->getSize(), "fg2b");
-    RT_ASSERT(graphdata->point[i] <= graphdata->y_size, "fg2c");
-    graphdata->point[i] = (graph->get(i) - ymin) * scale_factor + 0.5;
-    if (graphdata->point[i] >
-        graphdata->y_size) { // Can only be to bugs or rounding...
-      // force within display area, otherwise u8g2 would slow down hence data
-      // loss, etc. etc.
-      graphdata->point[i] = graphdata->y_size;
+    byte point = toPixel(y, ymin_m, scale_factor_m, graphdata->y_size);
+    byte point_low =
+        envelope ? toPixel(y_low, ymin_m, scale_factor_m, graphdata->y_size)
+                 : point;
+    for (byte j = 0; j < width; j++, n++) {
+      RT_ASSERT(n < graphdata->x_size, "!fg2a");
+      if (n >= graphdata->x_size) {
+        break; // protect from mem. corruption, only in case of a bug!
+      }
+      graphdata->point[n] = point;
+      graphdata->point_low[n] = point_low;
     }
   }
   if (graphdata->y0.isNegative() &&
@@ -904,9 +1211,28 @@ void K197device::fillGraphDisplayData(k197_display_graph_type *graphdata,
   } else {
     graphdata->y_zero = 0;
   }
-  graphdata->gr_size = gr_size;
+  graphdata->gr_size = n;
+  graphdata->first_changed = first;
+  graphdata->num_removed = num_removed;
+  graphdata->level = level;
+  graphdata->envelope = envelope;
+  graphdata->valid = true;
+  graphdata->hold = hold;
+  graphdata->canBeNegative = canBeNegative;
+  graphdata->yopt = yopt;
+  graphdata->val_pow10 = val_pow10;
+  graphdata->num_appended = num_appended;
+  graphdata->num_changed = num_changed;
   graphdata->nsamples_graph =
       hold ? cache.hold.nsamples_graph : cache.nsamples_graph;
+  if (level > 0) {
+    graphdata->sample_period =
+        getFramePeriod() * pyramid->getBucketSamples(l) / width;
+  } else {
+    graphdata->sample_period =
+        getFramePeriod(hold) *
+        (graphdata->nsamples_graph == 0 ? 1 : graphdata->nsamples_graph);
+  }
 }
 
 /*!
@@ -924,6 +1250,30 @@ void K197device::fillGraphDisplayData(k197_display_graph_type *graphdata,
     b1 = b_tmp;                                                                \
   }
 
+/*!
+   @brief compute sum and sum of squares of a range of graph points
+   @details the sums are relative to the first point, so that they keep
+   their precision whatever the values in the graph. The cost grows with the
+   number of points: O(num_blocks) with the block summaries of the live graph
+   (see k197_stored_graph_type::calcRange()), O(num_points) in hold mode
+   @param first_point the array index to use as a starting point
+   @param num_points the number of points [range: 0 - gr_size-1]
+   @param hold if true use the graph at the time hold mode was last entered
+   @param ref returns the reference value (mantissa)
+   @param sum returns the sum of (value - ref) (mantissa)
+   @param sumsq returns the sum of (value - ref)^2 (mantissa^2)
+*/
+void K197device::calcGraphSums(byte first_point, byte num_points, bool hold,
+                               long *ref, float *sum, float *sumsq) {
+  if (hold) {
+    *ref = cache.hold.graph.get(first_point);
+    cache.hold.graph.calcSums(first_point, num_points, *ref, sum, sumsq);
+  } else {
+    *ref = cache.graph.get(first_point);
+    cache.graph.calcSums(first_point, num_points, *ref, sum, sumsq);
+  }
+}
+
 /*!
    @brief get average of the graph
    @details note: the starting point must be an array index
@@ -934,8 +1284,58 @@ void K197device::fillGraphDisplayData(k197_display_graph_type *graphdata,
 */
 float K197device::getGraphAverage(byte first_point, byte num_points,
                                   bool hold) {
-  return hold ? cache.hold.graph.calcAverage(first_point, num_points)
-              : cache.graph.calcAverage(first_point, num_points);
+  if (num_points == 0)
+    return 0.0;
+  long ref;
+  float sum, sumsq;
+  calcGraphSums(first_point, num_points, hold, &ref, &sum, &sumsq);
+  return k197_value_type::toFloat(ref + sum / num_points,
+                                  hold ? cache.hold.val_pow10
+                                       : cache.val_pow10);
+}
+
+/*!
+   @brief get the RMS value of a range of graph points
+   @param first_point the array index to use as a starting point
+   @param num_points the number of points [range: 0 - gr_size-1]
+   @param hold if true returns the value at the time hold mode was last entered
+   @return the requested RMS value (or 0.0 if num_pts==0 or gr_size==0)
+*/
+float K197device::getGraphRMS(byte first_point, byte num_points, bool hold) {
+  if (num_points == 0)
+    return 0.0;
+  long ref;
+  float sum, sumsq;
+  calcGraphSums(first_point, num_points, hold, &ref, &sum, &sumsq);
+  // sum of value^2 = sum of ((value-ref) + ref)^2
+  float sumsq_abs = sumsq + 2.0 * ref * sum + float(ref) * ref * num_points;
+  if (sumsq_abs < 0.0) // rounding
+    sumsq_abs = 0.0;
+  return k197_value_type::toFloat(sqrt(sumsq_abs / num_points),
+                                  hold ? cache.hold.val_pow10
+                                       : cache.val_pow10);
+}
+
+/*!
+   @brief get the standard deviation of a range of graph points
+   @details this is the sample standard deviation (calculated with n-1)
+   @param first_point the array index to use as a starting point
+   @param num_points the number of points [range: 0 - gr_size-1]
+   @param hold if true returns the value at the time hold mode was last entered
+   @return the requested standard deviation (or 0.0 if num_pts<2)
+*/
+float K197device::getGraphStdDev(byte first_point, byte num_points,
+                                 bool hold) {
+  if (num_points < 2)
+    return 0.0;
+  long ref;
+  float sum, sumsq;
+  calcGraphSums(first_point, num_points, hold, &ref, &sum, &sumsq);
+  float var = (sumsq - sum * sum / num_points) / (num_points - 1);
+  if (var < 0.0) // rounding
+    var = 0.0;
+  return k197_value_type::toFloat(sqrt(var), hold ? cache.hold.val_pow10
+                                                  : cache.val_pow10);
 }
 
 /*!
@@ -959,55 +1359,404 @@ void K197device::k197_cache_struct::resampleGraph(uint16_t nsamples_new) {
     gr_size_new = graph.max_graph_size;
   RT_ASSERT(gr_size_new <= graph.max_graph_size, "rsmpl1a");
   RT_ASSERT(gr_size_new > 0, "rsmpl1b");
-  float buffer[gr_size_new];
 
+  PROFILE_start(DebugOut.PROFILE_RESAMPLE);
   if (nsamples_new >
       nsamples_graph) { // Decimation to match the new sample rate
-    //  Copy the decimated data into the buffer, with correct ordering
-    unsigned int new_idx = 0;
-    for (int old_idx = 0; old_idx < gr_size; old_idx++) {
-      if (old_idx * nsamples_old_positive >= new_idx * nsamples_new_positive) {
-        RT_ASSERT_ACT(new_idx >= gr_size_new,
-                      DebugOut.println("Error: new_idx 1");
-                      break;)
-        RT_ASSERT(new_idx < gr_size_new, "rsmpl2");
-        RT_ASSERT(old_idx < graph.getSize(), "rsmpl3");
-        buffer[new_idx] = graph.get(old_idx);
-        new_idx++;
-      }
+    // Note that nskip_graph does not need to change
+    gr_size_new = long(gr_size - 1) * long(nsamples_old_positive) /
+                      long(nsamples_new_positive) +
+                  1l;
+    graph.resample(gr_size_new, nsamples_old_positive, nsamples_new_positive,
+                   0, average_graph);
+  } else if (average_graph && box_n > 0) { // Add more data, averaging
+    // The extra values are the average of the group being averaged, which is
+    // not in the graph yet. Old data may be lost here if there is no room
+    unsigned int nextra = nskip_graph / nsamples_new_positive;
+    graph.resample(gr_size_new > nextra ? gr_size_new - nextra : 1,
+                   nsamples_old_positive, nsamples_new_positive, 0);
+    nskip_graph = nskip_graph % nsamples_new_positive;
+    float avg = box_sum / box_n;
+    for (unsigned int i = 0; i < nextra; i++) {
+      graph.append(box_ref + (avg < 0.0 ? long(avg - 0.5) : long(avg + 0.5)));
+      graph.extendEnvelope(box_min);
+      graph.extendEnvelope(box_max);
     }
-    RT_ASSERT(new_idx != gr_size_new, "Error: new_idx 2");
-    // Adjust cache size. Note that nskip_graph does not need to change
-    gr_size = new_idx;
+    box_sum = avg * nskip_graph; // the remaining samples, approximately
+    box_n = nskip_graph;
   } else { // Add more data to match the new sample rate
-    unsigned int old_idx = gr_size - 1;
-    unsigned int new_idx = gr_size_new - 1;
-
-    for (unsigned int n = 0; n < (nskip_graph / nsamples_new_positive); n++) {
-      RT_ASSERT(new_idx < gr_size_new, "rsmpl4");
-      RT_ASSERT(gr_size - 1 < graph.getSize(), "rsmpl5");
-      buffer[new_idx] = graph.get(gr_size - 1);
-      new_idx--;
-    }
+    // Old data may be lost here if there is no room
+    unsigned int nextra = nskip_graph / nsamples_new_positive;
+    graph.resample(gr_size_new, nsamples_old_positive, nsamples_new_positive,
+                   nextra < gr_size_new ? nextra : gr_size_new);
     // Adjust nskip_graph
     nskip_graph = nskip_graph % nsamples_new_positive;
+  }
+  PROFILE_stop(DebugOut.PROFILE_RESAMPLE);
+  CHECK_FREE_STACK();
+  nsamples_graph = nsamples_new;
+}
+
+/*!
+   @brief resample the graph in place
+   @details This is used by K197device::k197_cache_struct::resampleGraph().
+   The new value at position k (0 = oldest) is the old value at position
+   map(k), where:
+   - with step_new > step_old (decimation) map(k) is the first old value not
+   older than k, that is ceil(k * step_new / step_old). The envelope of the
+   new value includes all the old values from map(k) to map(k+1)-1. With
+   average, the new value is the average of the same old values
+   - with step_new < step_old (expansion) the last nextra values are copies of
+   the newest value, the others are floor(k * step_new / step_old), aligned to
+   the newest value if there is no room for all the data
+
+   map(k) is non decreasing, therefore all the values with map(k) > k can be
+   moved in increasing order of k, then all the values with map(k) < k in
+   decreasing order of k, without overwriting a value that is still needed.
+   Only O(1) additional memory is used.
+   @param size_new the new size of the graph
+   @param step_old the old sample period (number of measurements per value)
+   @param step_new the new sample period (number of measurements per value)
+   @param nextra the number of copies of the newest value to add at the end
+   (expansion only)
+   @param average if true average the old values (decimation only)
+*/
+void k197_stored_graph_type::resample(byte size_new, uint16_t step_old,
+                                      uint16_t step_new, byte nextra,
+                                      bool average) {
+  if (gr_size == 0 || size_new == 0 || size_new > max_graph_size)
+    return;
+  normalize();
+  byte n = gr_size;
+  while (gr_size < size_new) { // extend with copies of the newest value
+    gr_size++;
+    merge(gr_size - 1, n - 1, n - 1);
+  }
+  gr_index = gr_size - 1;
+
+  int k0 = int(size_new) - 1 - nextra; // the last value not in the extra part
+  byte start = n - 1;                  // map(k0) (expansion only)
+  if (k0 >= 0 && long(k0) * step_new < long(n - 1) * step_old)
+    start = n - 2;
+
+  for (byte pass = 0; pass < 2; pass++) {
+    for (byte i = 0; i < size_new; i++) {
+      byte k = pass == 0 ? i : size_new - 1 - i;
+      long j; // map(k)
+      if (step_new > step_old) {
+        j = (long(k) * step_new + step_old - 1) / step_old;
+      } else if (k > k0) {
+        j = n - 1;
+      } else {
+        j = long(k) * step_new / step_old;
+        long aligned = long(start) - (k0 - k);
+        if (aligned > j)
+          j = aligned;
+      }
+      RT_ASSERT(j < n, "!rsmpl2");
+      if (step_new > step_old) { // the envelope includes map(k)...map(k+1)-1
+        if (pass == 1)
+          break;
+        long last = (long(k + 1) * step_new + step_old - 1) / step_old - 1;
+        merge(k, j, last < n ? last : n - 1, average);
+      } else if ((pass == 0 && j > k) || (pass == 1 && j < k)) {
+        merge(k, j, j);
+      }
+    }
+  }
+  gr_size = size_new;
+  gr_index = gr_size - 1;
+  num_changed++;
+  dirty = 0xffff;
+}
+
+// ***************************************************************************************
+//  Self test
+// ***************************************************************************************
+
+#ifdef SELF_TEST
+
+/*!
+      @brief utility function, the segments used to display a character
+      @details this is the reverse of the seg2char lookup, used to build test
+   frames. This function can only be used within K197device.cpp
+      @param c the character, must be in seg2char
+      @param dp true if the decimal point must be on
+      @return the byte sent by the K197 for the character
+*/
+static byte char2seg(char c, bool dp) {
+  byte s = 0;
+  while (s < 0x7f && pgm_read_byte(&seg2char[s]) != c)
+    s++;
+  return ((s & 0b01111100) << 1) | (s & 0b00000011) | (dp ? 0b00000100 : 0);
+}
+
+/*!
+      @brief utility function, build the frame for a measurement in Volt
+      @details this function can only be used within K197device.cpp
+      @param data the frame (PACKET_DATA elements)
+      @param msg the message, with an optional '-' and '.' (PROGMEM)
+*/
+static void makeFrame(byte *data, const char *msg) {
+  memset(data, 0, PACKET_DATA);
+  byte i = 1;
+  bool dp = false;
+  for (char c = pgm_read_byte(msg); c != 0; c = pgm_read_byte(++msg)) {
+    if (c == '-') {
+      data[0] |= K197_MINUS_bm;
+    } else if (c == '.') {
+      dp = true;
+    } else if (i < 7) {
+      data[i++] = char2seg(c, dp);
+      dp = false;
+    }
+  }
+  while (i < 7)
+    data[i++] = char2seg(CH_SPACE, false);
+  data[7] = K197_V_bm;
+}
+
+/*!
+      @brief decode a frame the way it was done before decodeFrame() converted
+   the digits directly (build a string, then use atof())
+      @details used to compare the two methods. updateUnit() is called at the
+   end, so that the work done is the same as decodeFrame() except for the
+   conversion of the value
+      @param data byte array with the data received via SPI
+      @param n the number of valid bytes in data
+      @return the value of the message, 0.0 if not numeric
+*/
+float K197device::decodeReference(byte *data, byte n) {
+  annunciators0 = n > 0 ? data[0] : 0x00;
+  annunciators7 = n > 7 ? data[7] : 0x00;
+  annunciators8 = n > 8 ? data[8] : 0x00;
+  char message[K197_MSG_SIZE];
+  memset(message, 0, sizeof(message));
+  raw_msg[0] = CH_SPACE;
+  raw_msg[K197_RAW_MSG_SIZE - 1] = 0;
+  int nchar = 0;
+  if (n > 0 && isMINUS()) {
+    raw_msg[0] = '-';
+    message[nchar++] = '-';
+  }
+  int msg_n = n >= 7 ? 7 : n;
+  byte num_dp = 0;
+  bool is_num = true;
+  raw_dp = 0x00;
+  for (int i = 1; i < msg_n; i++) {
+    if (hasDecimalPoint(data[i])) {
+      bitSet(raw_dp, i);
+      if (++num_dp == 1)
+        message[nchar++] = '.';
+    }
+    int seg128 = ((data[i] & 0b11111000) >> 1) | (data[i] & 0b00000011);
+    char c = pgm_read_byte(&seg2char[seg128]);
+    raw_msg[i] = c;
+    message[nchar++] = c;
+    if (!isDigit(c) && c != CH_SPACE)
+      is_num = false;
+  }
+  float value = 0.0;
+  if (is_num) {
+    for (int i = 0; i < K197_MSG_SIZE - 1 && message[i] != 0; i++) {
+      if (message[i] != CH_SPACE) {
+        value = atof(message + i);
+        break;
+      }
+    }
+  }
+  updateUnit();
+  return value;
+}
+
+// Messages used by benchmarkDecode()
+static const char test_msg0[] PROGMEM = " 1.9999";
+static const char test_msg1[] PROGMEM = "-19.9999";
+static const char test_msg2[] PROGMEM = " 199.99";
+static const char test_msg3[] PROGMEM = " 0.0012";
+static const char test_msg4[] PROGMEM = "-123.456";
+static const char test_msg5[] PROGMEM = " 00000";
+static const char *const test_msgs[] PROGMEM = {
+    test_msg0, test_msg1, test_msg2,
+    test_msg3, test_msg4, test_msg5}; ///< messages used by benchmarkDecode()
+
+/*!
+      @brief compare decodeFrame() with decodeReference()
+      @details for each test message prints the time per frame with the two
+   methods (us) and the decoded values, which must be the same. The times are
+   only meaningful on the device: the host build has no real clock (see
+   host/host.h), and no AVR figures have been recorded so far
+      @param out the stream to print to (normally Serial)
+*/
+void K197device::benchmarkDecode(Print &out) {
+  const uint16_t iterations = 1000;
+  byte data[PACKET_DATA];
+  out.println(F("decode: msg old new (us/frame) value ref"));
+  for (byte m = 0; m < sizeof(test_msgs) / sizeof(test_msgs[0]); m++) {
+    const char *msg = (const char *)pgm_read_ptr(&test_msgs[m]);
+    makeFrame(data, msg);
+    float ref = 0.0;
+    unsigned long t0 = micros();
+    for (uint16_t i = 0; i < iterations; i++) {
+      wdt_reset(); // same cost in both loops
+      ref = decodeReference(data, PACKET_DATA);
+    }
+    unsigned long t1 = micros();
+    for (uint16_t i = 0; i < iterations; i++) {
+      wdt_reset();
+      decodeFrame(data, PACKET_DATA);
+    }
+    unsigned long t2 = micros();
+    float value = getValue();
+    out.print((const __FlashStringHelper *)msg);
+    out.print(CH_SPACE);
+    out.print(float(t1 - t0) / iterations);
+    out.print(CH_SPACE);
+    out.print(float(t2 - t1) / iterations);
+    out.print(CH_SPACE);
+    out.print(value, 6);
+    out.print(CH_SPACE);
+    out.print(ref, 6);
+    if (fabs(value - ref) > fabs(ref) * 1e-6)
+      out.print(F(" FAIL"));
+    out.println();
+  }
+  CHECK_FREE_STACK();
+}
+
+// Sample periods used by testResample()
+static const uint16_t test_periods[] PROGMEM = {0,  1,  2,  3,   4,   5,  7, 8,
+                                                10, 16, 30, 60, 100, 250, 600};
 
-    // Resample with shorter period. Old data may be lost here if there is no
-    // room
-    for (int i = new_idx; i >= 0; new_idx--, i--) {
-      if (new_idx * nsamples_new_positive < old_idx * nsamples_old_positive) {
-        if (old_idx > 0)
+/*!
+      @brief check resampleGraph() against the mapping used before the graph
+   was resampled in place
+      @details each iteration fills the graph with random values, resamples it
+   with a random period and checks each value against the old value it should
+   be copied from. The old values are saved before resampling. The graph is
+   also frozen in cache.hold.graph, and the values still in the snapshot after
+   resampling (the newest ones, see k197_graph_snapshot_type) are checked
+   against the old values, to check the copy on write. The values are kept
+   within the range of a block, so that no precision is lost when they are
+   moved. Averaging must be disabled
+      @param out the stream to print to (normally Serial)
+      @param iterations number of resampling operations to check
+      @return true if all the checks passed
+*/
+bool K197device::testResample(Print &out, uint16_t iterations) {
+  static byte idx[k197_stored_graph_type::max_graph_size]; // expected map(k)
+  static int16_t old[k197_stored_graph_type::max_graph_size]; // - base
+  const byte nperiods = sizeof(test_periods) / sizeof(test_periods[0]);
+  uint16_t nfail = 0;
+  uint16_t nskipped = 0;
+  unsigned long tmax = 0UL;
+  cache.resetGraph();
+  cache.nsamples_graph = pgm_read_word(&test_periods[0]);
+  long base = random(-100000L, 100000L);
+  for (uint16_t it = 0; it < iterations; it++) {
+    wdt_reset(); // the whole test takes longer than the watchdog period
+    for (uint16_t n = random(1, 2 * cache.graph.max_graph_size); n > 0; n--)
+      cache.graph.append(base + random(-15000L, 15000L));
+    byte gr_size = cache.graph.getSize();
+    for (byte k = 0; k < gr_size; k++)
+      old[k] = cache.graph.get(k) - base;
+    uint16_t ns_old = cache.nsamples_graph;
+    uint16_t ns_new = pgm_read_word(&test_periods[random(nperiods)]);
+    uint16_t no = ns_old == 0 ? 1 : ns_old;
+    uint16_t nn = ns_new == 0 ? 1 : ns_new;
+    cache.nskip_graph = random(no);
+
+    // the mapping, same as the original resampleGraph()
+    long size_new = long(gr_size - 1) * no / nn + 1 + cache.nskip_graph / nn;
+    if (size_new > cache.graph.max_graph_size)
+      size_new = cache.graph.max_graph_size;
+    uint16_t nskip_new = cache.nskip_graph;
+    if (ns_new == ns_old) {
+      size_new = gr_size;
+      for (byte k = 0; k < gr_size; k++)
+        idx[k] = k;
+    } else if (ns_new > ns_old) {
+      size_new = 0;
+      for (long i = 0; i < gr_size; i++) {
+        if (i * no >= size_new * nn)
+          idx[size_new++] = i;
+      }
+    } else {
+      long nextra = cache.nskip_graph / nn;
+      if (nextra >= size_new) { // not handled by the original code
+        nskipped++;
+        cache.resetGraph();
+        continue;
+      }
+      long old_idx = gr_size - 1;
+      long new_idx = size_new - 1;
+      for (long i = 0; i < nextra; i++)
+        idx[new_idx--] = gr_size - 1;
+      nskip_new = cache.nskip_graph % nn;
+      for (; new_idx >= 0; new_idx--) {
+        if (new_idx * nn < old_idx * no && old_idx > 0)
           old_idx--;
+        idx[new_idx] = old_idx;
       }
-      RT_ASSERT(new_idx < gr_size_new, "rsmpl6");
-      RT_ASSERT(old_idx < graph.getSize(), "rsmpl7");
-      buffer[new_idx] = graph.get(old_idx);
     }
-    // Adjust cache size
-    gr_size = gr_size_new;
+
+    cache.hold.graph.freeze(&cache.graph);
+    unsigned long t0 = micros();
+    cache.resampleGraph(ns_new);
+    unsigned long t = micros() - t0;
+    if (t > tmax)
+      tmax = t;
+    bool ok = cache.graph.getSize() == size_new &&
+              cache.nskip_graph == nskip_new &&
+              cache.nsamples_graph == ns_new;
+    for (byte k = 0; ok && k < size_new; k++)
+      ok = cache.graph.get(k) - base == old[idx[k]];
+    byte dropped = gr_size - cache.hold.graph.getSize();
+    for (byte k = dropped; ok && k < gr_size; k++)
+      ok = cache.hold.graph.get(k - dropped) - base == old[k];
+    cache.hold.graph.release();
+    if (!ok) {
+      nfail++;
+      out.print(F("FAIL size="));
+      out.print(gr_size);
+      out.print(F(" period="));
+      out.print(ns_old);
+      out.print(F("->"));
+      out.print(ns_new);
+      out.print(F(" nskip="));
+      out.println(cache.nskip_graph);
+      cache.resetGraph();
+    }
   }
-  CHECK_FREE_STACK(); // We may be using quite a bit of stack for the buffer
+  out.print(F("resample: n="));
+  out.print(iterations - nskipped);
+  out.print(F(" fail="));
+  out.print(nfail);
+  out.print(F(" max="));
+  out.print(tmax);
+  out.println(F("us"));
+  CHECK_FREE_STACK();
+  return nfail == 0;
+}
 
-  graph.copy(buffer, gr_size); // Copy the buffer back to the cache
-  nsamples_graph = nsamples_new;
+/*!
+    @brief  run the self tests and print the results
+    @details the self tests are used to check and measure the code that is
+   difficult to exercise with a real K197. Intended for development, the graph
+   and the statistics are cleared and the display hold is released
+    @param out the stream to print to (normally Serial)
+*/
+void K197device::selfTest(Print &out) {
+  setDisplayHold(false);
+  benchmarkDecode(out);
+  bool average = cache.average_graph;
+  uint16_t nsamples = cache.nsamples_graph;
+  cache.average_graph = false;
+  testResample(out, 1000);
+  cache.average_graph = average;
+  cache.nsamples_graph = nsamples;
+  resetStatistics();
+  last_n = 0; // the next frame must be decoded
 }
+
+#endif // SELF_TEST
@@ -21,7 +21,7 @@
 /**************************************************************************/
 #ifndef K197_DEVICE_H
 #define K197_DEVICE_H
-#include "DebugUtil.h"
+#include "debugUtil.h"
 #include "SPIdevice.h"
 #include <Arduino.h>
 #include <ctype.h> // isDigit()
@@ -238,6 +238,45 @@ inline bool operator>(const k197graph_label_type &lhs,
   return lhs.getValue() > rhs.getValue();
 };
 
+/**************************************************************************/
+/*!
+   @brief auxiliary class to store a measurement as a fixed point number
+
+   @details The K197/197A displays at most 6 digits and a decimal point, so a
+   measurement can be stored exactly as an integer mantissa and a power of 10.
+   Statistics and graph data are stored as integers to avoid the software
+   emulated floating point math of the AVR, float is used only when a value
+   is presented (display, log, etc.)
+*/
+/**************************************************************************/
+struct k197_value_type {
+  long mant = 0L;   ///< the mantissa. value = mant * 10^pow10
+  int8_t pow10 = 0; ///< the power of 10. value = mant * 10^pow10
+  static const long max_mant =
+      999999999L; ///< max. absolute value of a mantissa after scaling, it
+                  ///< leaves room to subtract two mantissas without overflow
+
+  /*!
+   @brief set new mantissa and new power of 10
+   @param new_mant the new mantissa
+   @param new_pow10 the new power of 10
+  */
+  void setValue(long new_mant, int8_t new_pow10) {
+    mant = new_mant;
+    pow10 = new_pow10;
+  };
+
+  /*!
+   @brief get the equivalent float value of the object
+   @return the value (mantissa * power of 10)
+  */
+  float getValue() const { return toFloat(mant, pow10); };
+
+  static float toFloat(float x, int8_t p);
+  static long scale(long m, int8_t k);
+  static bool canScale(long m, int8_t k);
+};
+
 /**************************************************************************/
 /*!
     @brief  Define the scaling options for the y axis
@@ -267,17 +306,36 @@ struct k197_display_graph_type {
   static const byte x_size = 180; ///< x size of the graph area in pixels
   static const byte y_size = 63;  ///< y size of the graph area in pixels
   byte point[x_size];             ///< point[0] is the oldest
+  byte point_low[x_size];         ///< min of the envelope (see envelope)
   byte gr_size = 0x00; ///< number of points in the graph (always < x_size)
   uint16_t nsamples_graph = 0; ///< Number of samples to use for graph
   k197graph_label_type y1;     ///< upper label y axis
   k197graph_label_type y0;     ///< lower label y axis
   byte y_zero = 0x00; ///< the point value for 0, if included in the graph
+  float sample_period = 0.0; ///< time between two points in seconds
+  byte level = 0; ///< 0 = graph, n = level n-1 of k197_graph_pyramid_type
+  bool envelope = false; ///< if true point[] is the max of the envelope
+  byte first_changed = 0; ///< the points before this one are the same as the
+                          ///< previous frame (shifted left by num_removed)
+  byte num_removed = 0;   ///< points removed from the start, see first_changed
+
+  // Used by K197device::fillGraphDisplayData() to reuse the previous frame
+  bool valid = false;         ///< true if the fields below are set
+  bool hold = false;          ///< hold parameter of the previous frame
+  bool canBeNegative = false; ///< canBeNegative used for the scale
+  k197graph_yscale_opt yopt = k197graph_yscale_zoom; ///< yopt for the scale
+  int8_t val_pow10 = 0;      ///< power of 10 of the graph values
+  float span = 0.0;          ///< max - min of the data when scaled
+  uint16_t num_appended = 0; ///< see k197_stored_graph_type
+  uint16_t num_changed = 0;  ///< see k197_stored_graph_type
 
   void
   setScale(float grmin, float grmax, k197graph_yscale_opt yopt,
            bool canBeNegative RT_ASSERT_ADD_PARAM(bool debug_flag = false));
 };
 
+struct k197_graph_snapshot_type; // forward declaration
+
 /**************************************************************************/
 /*!
    @brief  auxiliary class to store the graph in the device
@@ -289,23 +347,437 @@ struct k197_display_graph_type {
    room)
    - get() returns the record at a specific position (position=0 means oldest
    record)
-   - copy() copy from another object of the same type
-
+   - resample() resample the data in place
+
+   The values are stored as integer mantissas, the power of 10 is the same for
+   all the values and it is stored separately (see k197_value_type)
+
+   To save RAM the mantissas are compressed to 16 bits. The circular buffer is
+   divided in blocks of block_size values sharing a base value and a shift, each
+   value is stored as (value - base) >> shift (rounded). The shift is 0 (no
+   loss) unless the values in the block span more than 16 bits, which can
+   only happen with a big jump in the measurement (the error is then below
+   1/65535 of the jump). A block is encoded again every time the circular
+   buffer reaches its first slot, or when the new value does not fit.
+
+   Each value also has an envelope (min and max of all the measurements
+   represented by the value, including those skipped when nsamples_graph > 1,
+   see extendEnvelope()). The envelope is stored as the distance from the
+   value, in 4 bits with a shift common to the block (rounded up, so that the
+   envelope is never narrower than the real one). The distances below and
+   above the value share a byte, so the envelope costs one byte per value.
+
+   Each block also has a summary (min, max, sum and sum of squares of its
+   values), updated only when needed after the block has been changed. Min,
+   max and sums over a range of values use the summaries of the blocks
+   entirely in the range and decode the other values, see calcRange(). The
+   sums in a summary are relative to the minimum of the block, and each one
+   includes only block_size values, so their precision does not degrade over
+   time. The cost of a query grows with the number of blocks (it is not
+   constant): for the full graph, num_blocks summaries instead of
+   max_graph_size values.
 */
 /**************************************************************************/
 struct k197_stored_graph_type {
 public:
+  // One value for each pixel of the graph area (k197_display_graph_type). The
+  // RAM saved by the 16 bit values pays for the envelope and the block
+  // summaries, a longer history is kept by k197_graph_pyramid_type instead
   static const byte max_graph_size =
       180; ///< maximum number of measurements that can be stored
 
+  static const byte block_size = 12; ///< values sharing the same base value
+
 private:
-  float graph[max_graph_size];        ///< stores up to gr_size records
+  static const byte num_blocks =
+      max_graph_size / block_size; ///< number of blocks
+  static const long max_code = 32767L; ///< max. absolute value in graph
+  static const long max_env_code = 15L; ///< max. envelope distance code
+
+  int16_t graph[max_graph_size];      ///< stores up to gr_size records
                                       ///< when gr_size = max_graph_size
                                       ///< becomes a circular buffer
   byte gr_index = max_graph_size - 1; ///< index to the most recent record
   byte gr_size =
       0; ///< amount of data currently stored in graph (0-max_graph_size)
 
+  /*!
+     @brief  base value and shift of a block of values, see decode()
+  */
+  struct k197_graph_block_type {
+    long base = 0L;     ///< base value for the block
+    byte shift = 0;     ///< the values are stored as (value - base) >> shift
+    byte env_shift = 0; ///< shift for the envelope distances in env
+  };
+  k197_graph_block_type block[num_blocks]; ///< one for each block in graph
+
+  byte env[max_graph_size]; ///< (value - min) >> env_shift in the low nibble,
+                            ///< (max - value) >> env_shift in the high nibble
+
+  k197_graph_snapshot_type *snapshot = NULL; ///< frozen view, if any
+
+  uint16_t num_appended = 0; ///< counts the values appended, see append()
+  uint16_t num_changed = 0;  ///< counts all other changes to the values
+
+  inline void touch(byte b);
+
+  /*!
+     @brief  divide by 2^shift, rounding to the nearest integer
+     @param d the value to divide
+     @param shift the power of 2
+     @return the result
+  */
+  static long quantize(long d, byte shift) {
+    if (shift == 0)
+      return d;
+    long half = 1L << (shift - 1);
+    return d >= 0L ? (d + half) >> shift : -((half - d) >> shift);
+  };
+
+  /*!
+     @brief  decode the value stored in a slot
+     @param slot the slot in the circular buffer
+     @return the value stored in graph[slot]
+  */
+  long decode(byte slot) {
+    k197_graph_block_type *b = &block[slot / block_size];
+    return b->base + long(graph[slot]) * (1L << b->shift);
+  };
+
+  /*!
+     @brief  encode all the values in a block
+     @details base and shift are selected to fit all the values
+     @param b the block
+     @param v the values to encode (block_size values)
+     @param new_slot the slot where a new value is stored (if any)
+     @return true if any value already in the graph (other than new_slot) has
+     been changed by the encoding
+  */
+  bool encodeBlock(byte b, long v[], byte new_slot) {
+    touch(b);
+    long lo = v[0];
+    long hi = v[0];
+    for (byte i = 1; i < block_size; i++) {
+      if (v[i] < lo)
+        lo = v[i];
+      if (v[i] > hi)
+        hi = v[i];
+    }
+    long base = lo + (hi - lo) / 2;
+    byte shift = 0;
+    while (quantize(hi - base, shift) > max_code ||
+           quantize(lo - base, shift) < -max_code)
+      shift++;
+    block[b].base = base;
+    block[b].shift = shift;
+    bool changed = false;
+    byte first = b * block_size;
+    for (byte i = 0; i < block_size; i++) {
+      byte slot = first + i;
+      graph[slot] = quantize(v[i] - base, shift);
+      long y = decode(slot);
+      if (slot != new_slot && slot < gr_size && y != v[i]) {
+        changed = true;
+        // keep the envelope where it was
+        long unit = 1L << block[b].env_shift;
+        setEnvelope(slot, v[i] - envBelow(slot) * unit,
+                    v[i] + envAbove(slot) * unit);
+      }
+    }
+    return changed;
+  };
+
+  /*!
+     @brief  store a new value
+     @details the block is encoded again if needed, see encodeBlock()
+     @param slot the slot in the circular buffer
+     @param y the value to store
+     @return true if other values in the graph have been changed
+  */
+  bool store(byte slot, long y) {
+    byte b = slot / block_size;
+    byte first = b * block_size;
+    if (slot != first) {
+      long q = quantize(y - block[b].base, block[b].shift);
+      if (q >= -max_code && q <= max_code) {
+        touch(b);
+        graph[slot] = q;
+        return false;
+      }
+    }
+    long v[block_size];
+    for (byte i = 0; i < block_size; i++) {
+      byte s = first + i;
+      v[i] = (s == slot || s >= gr_size) ? y : decode(s);
+    }
+    return encodeBlock(b, v, slot);
+  };
+
+  /*!
+     @brief  min, max and sums of the values in a block, see calcRange()
+  */
+  struct k197_graph_summary_type {
+    long min = 0L;     ///< minimum value in the block
+    long max = 0L;     ///< maximum value in the block
+    float sum = 0.0;   ///< sum of (value - min)
+    float sumsq = 0.0; ///< sum of (value - min)^2
+  };
+  k197_graph_summary_type summary[num_blocks]; ///< one for each block
+  uint16_t dirty = 0xffff; ///< bit b set when summary[b] must be updated
+
+  /*!
+     @brief  calculate the summary of a block
+     @details only the slots up to gr_size are included. The sums are
+     relative to the minimum rather than to the base value, because the base
+     value can be far from all the values currently in the block (e.g. after a
+     jump, until the block is encoded again)
+     @param b the block
+  */
+  void updateSummary(byte b) {
+    k197_graph_summary_type *s = &summary[b];
+    byte first = b * block_size;
+    byte last = first + block_size < gr_size ? first + block_size : gr_size;
+    s->min = s->max = decode(first);
+    for (byte slot = first + 1; slot < last; slot++) {
+      long y = decode(slot);
+      if (y < s->min)
+        s->min = y;
+      if (y > s->max)
+        s->max = y;
+    }
+    s->sum = s->sumsq = 0.0;
+    for (byte slot = first; slot < last; slot++) {
+      float dev = decode(slot) - s->min;
+      s->sum += dev;
+      s->sumsq += dev * dev;
+    }
+    dirty &= ~(1U << b);
+  };
+
+  /*!
+     @brief  calculate min, max and sums of a range of values
+     @details the blocks entirely in the range use the block summary, the
+     other values are decoded one by one. The block sums are moved from the
+     block minimum to ref here: with d = min - ref, sum += S + n*d and
+     sumsq += Q + 2*d*S + n*d^2
+
+     The cost is O(num_blocks): one step for each block in the range plus up
+     to 2 * (block_size - 1) values decoded at the ends. A summary changed
+     since the last call is calculated again first (block_size values)
+     @param first_point the first point to consider (0 = oldest)
+     @param num_points the number of points to consider (at least 1)
+     @param ref the reference value for the sums
+     @param min returns the minimum value
+     @param max returns the maximum value
+     @param sum returns the sum of (value - ref), not calculated if NULL
+     @param sumsq returns the sum of (value - ref)^2, not calculated if NULL
+  */
+  void calcRange(byte first_point, byte num_points, long ref, long *min,
+                 long *max, float *sum = NULL, float *sumsq = NULL) {
+    byte slot = (first_point + gr_index + 1) % gr_size;
+    *min = *max = decode(slot);
+    if (sum != NULL)
+      *sum = *sumsq = 0.0;
+    while (num_points > 0) {
+      byte n = 1;
+      long lo, hi;
+      float s = 0.0;
+      float q = 0.0;
+      byte b = slot / block_size;
+      if (slot % block_size == 0 && num_points >= block_size &&
+          slot + block_size <= gr_size) {
+        if (dirty & (1U << b))
+          updateSummary(b);
+        n = block_size;
+        lo = summary[b].min;
+        hi = summary[b].max;
+        s = summary[b].sum;
+        q = summary[b].sumsq;
+      } else {
+        lo = hi = decode(slot);
+      }
+      if (lo < *min)
+        *min = lo;
+      if (hi > *max)
+        *max = hi;
+      if (sum != NULL) {
+        float d = lo - ref;
+        *sum += s + n * d;
+        *sumsq += q + 2.0 * d * s + n * d * d;
+      }
+      num_points -= n;
+      slot += n;
+      if (slot >= gr_size)
+        slot = 0;
+    }
+  };
+
+  /*!
+     @brief  encode an envelope distance
+     @param d the distance (>= 0)
+     @param shift the env_shift of the block
+     @return d >> shift rounded up, saturated to max_env_code
+  */
+  static byte envCode(long d, byte shift) {
+    d = (d + (1L << shift) - 1) >> shift;
+    return d > max_env_code ? max_env_code : d;
+  };
+
+  /*!
+     @brief  get the code of the envelope distance below a slot
+     @param slot the slot in the circular buffer
+     @return (value - min) >> env_shift
+  */
+  byte envBelow(byte slot) { return env[slot] & 0x0f; };
+
+  /*!
+     @brief  get the code of the envelope distance above a slot
+     @param slot the slot in the circular buffer
+     @return (max - value) >> env_shift
+  */
+  byte envAbove(byte slot) { return env[slot] >> 4; };
+
+  /*!
+     @brief  get the min of the envelope stored in a slot
+     @param slot the slot in the circular buffer
+     @return the min value
+  */
+  long slotMin(byte slot) {
+    return decode(slot) -
+           long(envBelow(slot)) * (1L << block[slot / block_size].env_shift);
+  };
+
+  /*!
+     @brief  get the max of the envelope stored in a slot
+     @param slot the slot in the circular buffer
+     @return the max value
+  */
+  long slotMax(byte slot) {
+    return decode(slot) +
+           long(envAbove(slot)) * (1L << block[slot / block_size].env_shift);
+  };
+
+  /*!
+     @brief  set the envelope of a slot
+     @details the env_shift of the block is set to the smallest value that
+     fits all the envelopes in the block. If this changes the envelope of
+     other values (rounded up to the new shift), the change is counted in
+     getChangeCount()
+     @param slot the slot in the circular buffer (the value must be stored
+     already)
+     @param min the min value
+     @param max the max value
+  */
+  void setEnvelope(byte slot, long min, long max) {
+    byte b = slot / block_size;
+    byte first = b * block_size;
+    touch(b);
+    long y = decode(slot);
+    long below = y > min ? y - min : 0L;
+    long above = max > y ? max - y : 0L;
+    byte shift = block[b].env_shift;
+    long dmax = below > above ? below : above;
+    for (byte s = first; s < first + block_size && s < gr_size; s++) {
+      if (s == slot)
+        continue;
+      byte code = envBelow(s) > envAbove(s) ? envBelow(s) : envAbove(s);
+      long d = long(code) * (1L << shift);
+      if (d > dmax)
+        dmax = d;
+    }
+    byte new_shift = 0;
+    while (((dmax + (1L << new_shift) - 1) >> new_shift) > max_env_code)
+      new_shift++;
+    if (new_shift != shift) {
+      bool changed = false;
+      for (byte s = first; s < first + block_size && s < gr_size; s++) {
+        long below_s = long(envBelow(s)) * (1L << shift);
+        long above_s = long(envAbove(s)) * (1L << shift);
+        env[s] = envCode(below_s, new_shift) |
+                 (envCode(above_s, new_shift) << 4);
+        // a larger shift can round up the envelope of the other values
+        if (s != slot && (long(envBelow(s)) * (1L << new_shift) != below_s ||
+                          long(envAbove(s)) * (1L << new_shift) != above_s))
+          changed = true;
+      }
+      block[b].env_shift = new_shift;
+      if (changed)
+        num_changed++;
+    }
+    env[slot] = envCode(below, new_shift) | (envCode(above, new_shift) << 4);
+  };
+
+  /*!
+     @brief  copy value and envelope of a range of slots to another slot
+     @details the envelope is extended to include all the slots in the range
+     @param dest the destination slot
+     @param first the first slot to copy (the value is copied from here)
+     @param last the last slot to copy
+     @param average if true the value is the average of the range, rather
+     than the value in first
+  */
+  void merge(byte dest, byte first, byte last, bool average = false) {
+    long y = decode(first);
+    long min = slotMin(first);
+    long max = slotMax(first);
+    float sum = 0.0; // relative to y, to keep the precision
+    for (byte s = first + 1; s <= last; s++) {
+      long mins = slotMin(s);
+      long maxs = slotMax(s);
+      if (mins < min)
+        min = mins;
+      if (maxs > max)
+        max = maxs;
+      if (average)
+        sum += decode(s) - y;
+    }
+    if (average) {
+      sum /= last - first + 1;
+      y += sum < 0.0 ? long(sum - 0.5) : long(sum + 0.5);
+    }
+    store(dest, y);
+    setEnvelope(dest, min, max);
+  };
+
+  /*!
+     @brief  swap the values stored in two slots
+     @param a the first slot
+     @param b the second slot
+  */
+  void swap(byte a, byte b) {
+    long ya = decode(a);
+    long mina = slotMin(a);
+    long maxa = slotMax(a);
+    merge(a, b, b);
+    store(b, ya);
+    setEnvelope(b, mina, maxa);
+  };
+
+  /*!
+     @brief  reverse the values stored in a range of slots
+     @param first the first slot
+     @param last the last slot
+  */
+  void reverse(byte first, byte last) {
+    while (first < last)
+      swap(first++, last--);
+  };
+
+  /*!
+     @brief  move the data so that the oldest value is stored in slot 0
+     @details this is always the case until the graph is full. The circular
+     buffer is rotated in place with three reversals.
+  */
+  void normalize() {
+    byte r = gr_index + 1; // slot of the oldest value
+    if (gr_size < max_graph_size || r >= gr_size)
+      return;
+    reverse(0, r - 1);
+    reverse(r, gr_size - 1);
+    reverse(0, gr_size - 1);
+    gr_index = gr_size - 1;
+  };
+
 public:
   /*!
      @brief  empty the graph
@@ -313,69 +785,104 @@ public:
   void clear() {
     gr_index = max_graph_size - 1;
     gr_size = 0;
+    num_changed++;
+    dirty = 0xffff;
   };
 
   /*!
      @brief  append a new value to the graph
      @details the oldest value will be removed if there is no space available
      @param y the value to append
+     @return true if other values have been changed by the compression (this
+     can only happen after a big jump in the values, see
+     k197_stored_graph_type)
    */
-  void append(float y) {
+  bool append(long y) {
     RT_ASSERT(gr_size <= max_graph_size, "!appnd1");
     RT_ASSERT((gr_size == 0) || (gr_index < gr_size), "!appnd2");
     gr_index++;
     if (gr_index >= max_graph_size)
       gr_index = 0;
-    graph[gr_index] = y;
     if (gr_size < max_graph_size)
       gr_size++;
+    bool changed = store(gr_index, y);
+    setEnvelope(gr_index, y, y);
+    num_appended++;
+    if (changed)
+      num_changed++;
+    return changed;
+  };
+
+  /*!
+     @brief  extend the envelope of the newest value to include a measurement
+     @details used for the measurements that are not stored in the graph
+     @param y the measurement
+   */
+  void extendEnvelope(long y) {
+    if (gr_size == 0)
+      return;
+    long min = slotMin(gr_index);
+    long max = slotMax(gr_index);
+    if (y < min || y > max)
+      setEnvelope(gr_index, y < min ? y : min, y > max ? y : max);
   };
 
   /*!
     @brief  get a specific value
     @param position required position. Range: 0 to gr_size-1. 0 is the oldes
     value, gr_zize-1 is the newest value.
-    @return the value at the required position or 0.0 if the graph is empty
+    @return the value at the required position or 0 if the graph is empty
   */
-  inline float get(unsigned int position) {
+  inline long get(unsigned int position) {
     if (gr_size == 0)
-      return 0.0;
+      return 0L;
     RT_ASSERT_ACT(position < gr_size, DebugOut.print(F("!getp="));
                   DebugOut.print(position); DebugOut.print(F(" sz="));
                   DebugOut.print(gr_size););
-    return graph[(position + gr_index + 1) % gr_size];
+    return decode((position + gr_index + 1) % gr_size);
+  };
+
+  /*!
+    @brief  get the min or max of the envelope at a specific position
+    @param position required position (see get())
+    @param max if true returns the max, otherwise the min
+    @return the min or max value or 0 if the graph is empty
+  */
+  long getEnvelope(unsigned int position, bool max) {
+    if (gr_size == 0)
+      return 0L;
+    byte slot = (position + gr_index + 1) % gr_size;
+    return max ? slotMax(slot) : slotMin(slot);
   };
 
   /*!
-    @brief copy all data from another k197_stored_graph_type
-    @param source the object to copy from.
+    @brief get the minimum of the envelope over the whole graph
+    @return  minimum value or 0 if the graph is empty.
   */
-  void copy(k197_stored_graph_type *source) {
-    if (source->gr_size > 0) {
-      memcpy(graph, source->graph, source->gr_size * sizeof(float));
+  long calcEnvelopeMin() {
+    long y = calcMin();
+    for (byte s = 0; s < gr_size; s++) {
+      long ys = slotMin(s);
+      if (ys < y)
+        y = ys;
     }
-    gr_index = source->gr_index;
-    gr_size = source->gr_size;
-    RT_ASSERT(gr_size <= max_graph_size, "!copy1");
-    RT_ASSERT(gr_index < gr_size, "!copy2");
+    return y;
   }
 
   /*!
-    @brief copy all data from a float array
-    @details num_points == 0 has the same effect as clear()
-    @param buffer the pointer to the float array
-    @param num_points the number of values to copy (starting from buffer[0].
+    @brief get the maximum of the envelope over the whole graph
+    @return  maximum value or 0 if the graph is empty.
   */
-  void copy(float buffer[], byte num_points) {
-    if (num_points == 0) {
-      clear();
-      return;
+  long calcEnvelopeMax() {
+    long y = calcMax();
+    for (byte s = 0; s < gr_size; s++) {
+      long ys = slotMax(s);
+      if (ys > y)
+        y = ys;
     }
-    RT_ASSERT(num_points < max_graph_size, "!copy(b,n)");
-    memcpy(graph, buffer, num_points * sizeof(float));
-    gr_index = num_points - 1;
-    gr_size = num_points;
+    return y;
   }
+
   /*!
     @brief return the number of data points in the graph
     @return the number of data points.
@@ -383,65 +890,87 @@ public:
   inline byte getSize() { return gr_size; };
 
   /*!
-    @brief compute tha maximum value in the graph
-    @return  maximum value or 0.0 if the graph is empty.
+    @brief get the minimum value in the graph
+    @details see calcRange(), the cost is O(num_blocks)
+    @param first_point the first point to consider (0 = oldest), the minimum of
+    the points from first_point to the newest is returned
+    @return  minimum value or 0 if the graph is empty.
   */
-  float calcMin() {
+  long calcMin(byte first_point = 0) {
     if (gr_size == 0)
-      return 0.0;
-    float min = graph[0];
-    for (byte i = 1; i < gr_size; i++) {
-      if (graph[i] < min)
-        min = graph[i];
-    }
+      return 0L;
+    RT_ASSERT(first_point < gr_size, "!calcMin");
+    long min, max;
+    calcRange(first_point, gr_size - first_point, 0L, &min, &max);
     return min;
   }
 
   /*!
-    @brief compute tha minimum value in the graph
-    @return  minimum value or 0.0 if the graph is empty.
+    @brief get the maximum value in the graph
+    @details see calcRange(), the cost is O(num_blocks)
+    @param first_point the first point to consider (0 = oldest), the maximum of
+    the points from first_point to the newest is returned
+    @return  maximum value or 0 if the graph is empty.
   */
-  float calcMax() {
+  long calcMax(byte first_point = 0) {
     if (gr_size == 0)
-      return 0.0;
-    float max = graph[0];
-    for (byte i = 1; i < gr_size; i++) {
-      if (graph[i] > max)
-        max = graph[i];
-    }
+      return 0L;
+    RT_ASSERT(first_point < gr_size, "!calcMax");
+    long min, max;
+    calcRange(first_point, gr_size - first_point, 0L, &min, &max);
     return max;
   }
 
   /*!
-    @brief compute tha average value in the graph
+    @brief compute sum and sum of squares of a range of values in the graph
+    @details see k197_graph_snapshot_type::calcSums(). Uses the block
+    summaries, see calcRange(), the cost is O(num_blocks)
     @param first_point the first point to consider
     @param num_points the number of points to consider
-    @return the computed average value or 0.0 if the graph is empty.
-  */
-  float calcAverage(byte first_point, byte num_points) {
-    if (gr_size == 0)
-      return 0.0;
-    RT_ASSERT(first_point < gr_size, "!calcA1");
-    float acc = 0.0;
-    byte last_point = first_point + num_points - 1;
-    RT_ASSERT(last_point < gr_size, "!calcA2");
-    for (byte i = first_point; i <= last_point; i++) {
-      acc += get(i);
-    }
-    return num_points == 0 ? acc : acc / num_points;
+    @param ref the reference value
+    @param sum returns the sum of (value - ref)
+    @param sumsq returns the sum of (value - ref)^2
+  */
+  void calcSums(byte first_point, byte num_points, long ref, float *sum,
+                float *sumsq) {
+    *sum = *sumsq = 0.0;
+    if (gr_size == 0 || num_points == 0)
+      return;
+    RT_ASSERT(first_point < gr_size, "!calcS1");
+    RT_ASSERT(first_point + num_points <= gr_size, "!calcS2");
+    long min, max;
+    calcRange(first_point, num_points, ref, &min, &max, sum, sumsq);
   }
 
   /*!
     @brief  rescale graph data
-    @details every point in the graph is multiplied by fconv
-    @param fconv the conversion factor
-  */
-  void rescale(float fconv) {
-    for (int i = 0; i < gr_size; i++) {
-      graph[i] *= fconv;
+    @details every point in the graph is multiplied by 10^k (see
+    k197_value_type::scale())
+    @param k the power of 10
+  */
+  void rescale(int8_t k) {
+    for (byte first = 0; first < gr_size; first += block_size) {
+      touch(first / block_size);
+      long v[block_size];
+      long min[block_size];
+      long max[block_size];
+      for (byte i = 0; i < block_size; i++) {
+        byte j = first + i < gr_size ? first + i : first;
+        v[i] = k197_value_type::scale(decode(j), k);
+        min[i] = k197_value_type::scale(slotMin(j), k);
+        max[i] = k197_value_type::scale(slotMax(j), k);
+        env[j] = 0;
+      }
+      encodeBlock(first / block_size, v, first);
+      for (byte i = 0; i < block_size && first + i < gr_size; i++)
+        setEnvelope(first + i, min[i], max[i]);
     }
+    num_changed++;
   }
 
+  void resample(byte size_new, uint16_t step_old, uint16_t step_new,
+                byte nextra, bool average = false);
+
   /*!
     @brief  check if the graph is full
     @details a full graph has reached its maximum size. Note that oit is still
@@ -449,6 +978,666 @@ public:
     @return true if the graph includes max_graph_size points
   */
   bool isFull() { return gr_size == max_graph_size ? true : false; }
+
+  /*!
+    @brief  get the number of values appended so far
+    @details the count wraps around, only the difference between two calls is
+    meaningful. As long as getChangeCount() does not change, the values
+    appended in between are the only difference in the graph (apart from the
+    envelope of the newest value, see extendEnvelope())
+    @return the number of calls to append()
+  */
+  uint16_t getAppendCount() { return num_appended; }
+
+  /*!
+    @brief  get the number of changes to the values already in the graph
+    @details see getAppendCount()
+    @return the number of calls to clear(), rescale(), resample() plus the
+    calls to append() that returned true and the changes to the envelope of
+    other values, see setEnvelope()
+  */
+  uint16_t getChangeCount() { return num_changed; }
+
+  friend struct k197_graph_snapshot_type;
+};
+
+/**************************************************************************/
+/*!
+   @brief  frozen view of a k197_stored_graph_type, used for hold mode
+
+   @details freeze() only takes note of the graph size and position, the data
+   is still read from the live graph. Before the live graph changes a block
+   (see k197_stored_graph_type) the block is copied to a small pool
+   (copy-on-write), so entering hold mode takes constant time and only the
+   blocks that are actually overwritten are copied.
+
+   The pool has room for pool_size blocks, less than the whole graph. When it
+   is full the oldest values are dropped from the view to make room: the
+   copied block with the oldest newest value is released and getSize() is
+   reduced accordingly. While the live graph keeps running, the view shrinks
+   to the newest pool_size * block_size values or so and then stays there. A
+   change to all the blocks (resample() or rescale() of the live graph) gets
+   there at once.
+
+   Minimum, maximum and sums are calculated with a simple loop. This is fast
+   enough for a graph that does not change, and saves the RAM used by the
+   block summaries of the live graph.
+*/
+/**************************************************************************/
+struct k197_graph_snapshot_type {
+private:
+  static const byte max_graph_size =
+      k197_stored_graph_type::max_graph_size; ///< same as the graph
+  static const byte block_size =
+      k197_stored_graph_type::block_size; ///< same as the graph
+  static const byte num_blocks =
+      k197_stored_graph_type::num_blocks; ///< same as the graph
+  static const byte pool_size = 6; ///< blocks that can be copied (max 8)
+
+  /*!
+     @brief  a block copied from the live graph
+  */
+  struct k197_graph_copy_type {
+    int16_t graph[block_size]; ///< copy of the values
+    byte env[block_size];      ///< copy of the envelope
+    k197_stored_graph_type::k197_graph_block_type
+        block; ///< copy of base and shifts
+  };
+
+  k197_stored_graph_type *source = NULL; ///< the live graph (if frozen)
+  byte gr_index = 0;                     ///< gr_index of the live graph
+  byte gr_size = 0;                      ///< gr_size of the live graph
+  byte trim = 0;                         ///< oldest values dropped
+  byte used = 0;                         ///< bit p set when pool[p] is used
+  byte copy[num_blocks] = {0};           ///< 1 + pool index, 0 if not copied
+  k197_graph_copy_type pool[pool_size];  ///< the copied blocks
+
+  /*!
+     @brief  decode the value stored in a slot
+     @param slot the slot in the circular buffer
+     @return the value stored in the slot at the time of freeze()
+  */
+  long decode(byte slot) {
+    byte b = slot / block_size;
+    if (copy[b] == 0)
+      return source->decode(slot);
+    k197_graph_copy_type *c = &pool[copy[b] - 1];
+    return c->block.base +
+           long(c->graph[slot % block_size]) * (1L << c->block.shift);
+  };
+
+  /*!
+     @brief  get the envelope stored in a slot
+     @param slot the slot in the circular buffer
+     @param max if true returns the max, otherwise the min
+     @return the min or max value at the time of freeze()
+  */
+  long decodeEnvelope(byte slot, bool max) {
+    byte b = slot / block_size;
+    if (copy[b] == 0)
+      return max ? source->slotMax(slot) : source->slotMin(slot);
+    k197_graph_copy_type *c = &pool[copy[b] - 1];
+    byte env = c->env[slot % block_size];
+    long unit = 1L << c->block.env_shift;
+    return max ? decode(slot) + (env >> 4) * unit
+               : decode(slot) - (env & 0x0f) * unit;
+  };
+
+  /*!
+     @brief  find the slot of a position
+     @param position the position (0 = oldest value in the view)
+     @return the slot in the circular buffer
+  */
+  byte slotOf(unsigned int position) {
+    return (position + trim + gr_index + 1) % gr_size;
+  };
+
+  /*!
+     @brief  find the newest value of the view stored in a block
+     @param b the block
+     @return the position of the value counting the values dropped as well (0
+     = oldest value at the time of freeze()), -1 if the block has no values
+  */
+  int lastPosition(byte b) {
+    int last = -1;
+    for (byte slot = b * block_size;
+         slot < (b + 1) * block_size && slot < gr_size; slot++) {
+      int position = (slot + gr_size - gr_index - 1) % gr_size;
+      if (position > last)
+        last = position;
+    }
+    return last;
+  };
+
+  /*!
+     @brief  release the copied blocks with no values left in the view
+  */
+  void releaseTrimmed() {
+    for (byte b = 0; b < num_blocks; b++) {
+      if (copy[b] != 0 && lastPosition(b) < trim) {
+        used &= ~(1 << (copy[b] - 1));
+        copy[b] = 0;
+      }
+    }
+  };
+
+public:
+  /*!
+     @brief  freeze the current content of a graph
+     @param g the live graph
+  */
+  void freeze(k197_stored_graph_type *g) {
+    release();
+    source = g;
+    gr_index = g->gr_index;
+    gr_size = g->gr_size;
+    g->snapshot = this;
+  };
+
+  /*!
+     @brief  stop following the live graph, the snapshot becomes empty
+  */
+  void release() {
+    if (source != NULL)
+      source->snapshot = NULL;
+    source = NULL;
+    gr_size = 0;
+    trim = 0;
+    used = 0;
+    memset(copy, 0, sizeof(copy));
+  };
+
+  /*!
+     @brief  copy a block before it is changed in the live graph
+     @details if the pool is full the oldest values are dropped, see
+     k197_graph_snapshot_type
+     @param b the block
+  */
+  void preserve(byte b) {
+    if (copy[b] != 0 || lastPosition(b) < trim)
+      return; // already copied, or nothing to keep
+    if (used == (1 << pool_size) - 1) {
+      byte oldest = b;
+      for (byte c = 0; c < num_blocks; c++) {
+        if (copy[c] != 0 && lastPosition(c) < lastPosition(oldest))
+          oldest = c;
+      }
+      trim = lastPosition(oldest) + 1;
+      releaseTrimmed();
+      if (oldest == b)
+        return;
+    }
+    byte p = 0;
+    while (used & (1 << p))
+      p++;
+    k197_graph_copy_type *c = &pool[p];
+    memcpy(c->graph, &source->graph[b * block_size],
+           block_size * sizeof(int16_t));
+    memcpy(c->env, &source->env[b * block_size], block_size);
+    c->block = source->block[b];
+    used |= 1 << p;
+    copy[b] = p + 1;
+  };
+
+  /*!
+    @brief return the number of data points in the graph
+    @return the number of data points.
+  */
+  inline byte getSize() { return gr_size - trim; };
+
+  /*!
+    @brief  get a specific value
+    @param position required position. Range: 0 to getSize()-1. 0 is the
+    oldest value, getSize()-1 is the newest value.
+    @return the value at the required position or 0 if the graph is empty
+  */
+  long get(unsigned int position) {
+    if (getSize() == 0)
+      return 0L;
+    RT_ASSERT(position < getSize(), "!snget");
+    return decode(slotOf(position));
+  };
+
+  /*!
+    @brief  get the min or max of the envelope at a specific position
+    @param position required position (see get())
+    @param max if true returns the max, otherwise the min
+    @return the min or max value or 0 if the graph is empty
+  */
+  long getEnvelope(unsigned int position, bool max) {
+    if (getSize() == 0)
+      return 0L;
+    return decodeEnvelope(slotOf(position), max);
+  };
+
+  /*!
+    @brief get the minimum of the envelope over the whole graph
+    @return  minimum value or 0 if the graph is empty.
+  */
+  long calcEnvelopeMin() {
+    long y = get(0);
+    for (byte i = 0; i < getSize(); i++) {
+      long yi = getEnvelope(i, false);
+      if (yi < y)
+        y = yi;
+    }
+    return y;
+  };
+
+  /*!
+    @brief get the maximum of the envelope over the whole graph
+    @return  maximum value or 0 if the graph is empty.
+  */
+  long calcEnvelopeMax() {
+    long y = get(0);
+    for (byte i = 0; i < getSize(); i++) {
+      long yi = getEnvelope(i, true);
+      if (yi > y)
+        y = yi;
+    }
+    return y;
+  };
+
+  /*!
+    @brief get the minimum value in the last part of the graph
+    @param first_point the first point to consider (0 = oldest)
+    @return  minimum value or 0 if the graph is empty.
+  */
+  long calcMin(byte first_point = 0) {
+    long y = get(first_point);
+    for (byte i = first_point + 1; i < getSize(); i++) {
+      long yi = get(i);
+      if (yi < y)
+        y = yi;
+    }
+    return y;
+  };
+
+  /*!
+    @brief get the maximum value in the last part of the graph
+    @param first_point the first point to consider (0 = oldest)
+    @return  maximum value or 0 if the graph is empty.
+  */
+  long calcMax(byte first_point = 0) {
+    long y = get(first_point);
+    for (byte i = first_point + 1; i < getSize(); i++) {
+      long yi = get(i);
+      if (yi > y)
+        y = yi;
+    }
+    return y;
+  };
+
+  /*!
+    @brief compute sum and sum of squares of a range of values in the graph
+    @details the sums are calculated for the difference between each value
+    and a reference value, to preserve the float precision. See also
+    k197_stored_graph_type::calcSums(), that does the same with the block
+    summaries of the live graph
+    @param first_point the first point to consider
+    @param num_points the number of points to consider
+    @param ref the reference value
+    @param sum returns the sum of (value - ref)
+    @param sumsq returns the sum of (value - ref)^2
+  */
+  void calcSums(byte first_point, byte num_points, long ref, float *sum,
+                float *sumsq) {
+    *sum = *sumsq = 0.0;
+    if (getSize() == 0 || num_points == 0)
+      return;
+    RT_ASSERT(first_point < getSize(), "!calcA1");
+    byte last_point = first_point + num_points - 1;
+    RT_ASSERT(last_point < getSize(), "!calcA2");
+    for (byte i = first_point; i <= last_point; i++) {
+      float dev = get(i) - ref;
+      *sum += dev;
+      *sumsq += dev * dev;
+    }
+  }
+};
+
+/*!
+   @brief  called before block b is changed, see k197_graph_snapshot_type
+   @param b the block
+*/
+inline void k197_stored_graph_type::touch(byte b) {
+  dirty |= 1U << b;
+  if (snapshot != NULL)
+    snapshot->preserve(b);
+}
+
+/**************************************************************************/
+/*!
+   @brief  auxiliary class to store a multi-resolution history of the values
+
+   @details The graph (k197_stored_graph_type) can only cover a longer time by
+   resampling it, which throws away the detail. This class keeps in addition
+   a number of levels, each one storing the last level_size buckets. A bucket
+   summarizes a group of consecutive values with their min, average and max.
+
+   All the values are added with append(). A bucket in level 0 summarizes
+   factor^2 values, each bucket in level n+1 summarizes factor buckets of
+   level n. Each level therefore covers a time span factor times longer than
+   the previous one, and level 0 covers factor times the graph at full speed.
+   All levels are updated incrementally, there is never a resampling pass.
+
+   To save RAM min and max are stored as a 4 bit distance from the average,
+   with a shift common to a group of group_size buckets (rounded up, like the
+   envelope in k197_stored_graph_type). Both distances share a byte. The
+   shift grows when a new bucket needs it, and is calculated again every time
+   the circular buffer reaches the first bucket of the group, so a spike only
+   reduces the resolution of the buckets in the same group.
+*/
+/**************************************************************************/
+struct k197_graph_pyramid_type {
+  static const byte levels = 3; ///< number of levels
+  static const byte factor = 4; ///< decimation factor between levels
+  static const byte level_size =
+      k197_stored_graph_type::max_graph_size / factor; ///< buckets per level
+  static const byte group_size = 9; ///< buckets sharing the same env_shift
+  static const byte num_groups = level_size / group_size; ///< per level
+
+private:
+  /*!
+     @brief  summary of a group of values
+  */
+  struct bucket_type {
+    long avg; ///< the average value
+    byte env; ///< (average - min) >> env_shift of the group in the low nibble,
+              ///< (max - average) >> env_shift in the high nibble
+  };
+
+  /*!
+     @brief  used to build the next bucket
+  */
+  struct acc_type {
+    float sum = 0.0; ///< sum of the averages added so far
+    long min = 0L;   ///< min of the values added so far
+    long max = 0L;   ///< max of the values added so far
+    byte n = 0;      ///< number of averages added so far
+  };
+
+  bucket_type bucket[levels][level_size]; ///< circular buffer for each level
+  byte lv_index[levels] = {0}; ///< index of the newest bucket in each level
+  byte lv_size[levels] = {0};  ///< number of buckets in each level
+  byte env_shift[levels][num_groups] = {{0}}; ///< shift for below and above
+  acc_type acc[levels + 1]; ///< acc[0] groups the values, acc[n+1] level n
+
+  static const long max_code = 15L;  ///< max. distance code (4 bits)
+  static const byte max_shift = 27; ///< max_code << max_shift fits in a long
+
+  /*!
+     @brief  encode a distance
+     @param d the distance (negative values are the same as 0)
+     @param shift the env_shift of the group
+     @return d >> shift rounded up, saturated to max_code
+  */
+  static byte envCode(long d, byte shift) {
+    if (d <= 0L)
+      return 0;
+    long q = d >> shift;
+    if ((q << shift) != d)
+      q++;
+    return q > max_code ? max_code : q;
+  };
+
+  /*!
+     @brief  encode both distances of a bucket
+     @param below the distance of the min
+     @param above the distance of the max
+     @param shift the env_shift of the group
+     @return the packed codes, see bucket_type
+  */
+  static byte envCodes(long below, long above, byte shift) {
+    return envCode(below, shift) | (envCode(above, shift) << 4);
+  };
+
+  /*!
+     @brief  find the smallest shift that can encode a distance
+     @param d the distance
+     @param shift the minimum shift to return
+     @return the shift, at most max_shift
+  */
+  static byte fitShift(long d, byte shift = 0) {
+    while (shift < max_shift && d > (max_code << shift))
+      shift++;
+    return shift;
+  };
+
+  /*!
+     @brief  get the distance encoded in a bucket
+     @param l the level
+     @param i the index of the bucket in the circular buffer
+     @param above if true the distance of the max, otherwise of the min
+     @return the distance from the average
+  */
+  long distance(byte l, byte i, bool above) {
+    byte code = above ? bucket[l][i].env >> 4 : bucket[l][i].env & 0x0f;
+    return long(code) << env_shift[l][i / group_size];
+  };
+
+  /*!
+     @brief  change the shift of a group, encoding its buckets again
+     @param l the level
+     @param g the group
+     @param shift the new shift
+  */
+  void setShift(byte l, byte g, byte shift) {
+    for (byte i = g * group_size; i < (g + 1) * group_size && i < lv_size[l];
+         i++)
+      bucket[l][i].env =
+          envCodes(distance(l, i, false), distance(l, i, true), shift);
+    env_shift[l][g] = shift;
+  };
+
+  /*!
+     @brief  add a new bucket to a level
+     @param l the level
+     @param avg the average value of the new bucket
+     @param min the min value of the new bucket
+     @param max the max value of the new bucket
+  */
+  void store(byte l, float avg, long min, long max) {
+    if (lv_size[l] == 0) {
+      lv_index[l] = 0;
+      lv_size[l] = 1;
+    } else {
+      if (++lv_index[l] >= level_size)
+        lv_index[l] = 0;
+      if (lv_size[l] < level_size)
+        lv_size[l]++;
+    }
+    byte i = lv_index[l];
+    byte g = i / group_size;
+    long y = avg < 0.0 ? long(avg - 0.5) : long(avg + 0.5);
+    byte shift = fitShift(y - min > max - y ? y - min : max - y);
+    if (i % group_size == 0) { // first bucket, the shift can be reduced
+      for (byte j = i + 1; j < i + group_size && j < lv_size[l]; j++) {
+        shift = fitShift(distance(l, j, false), shift);
+        shift = fitShift(distance(l, j, true), shift);
+      }
+    } else if (shift < env_shift[l][g]) {
+      shift = env_shift[l][g];
+    }
+    if (shift != env_shift[l][g])
+      setShift(l, g, shift);
+    bucket_type *b = &bucket[l][i];
+    b->avg = y;
+    b->env = envCodes(y - min, max - y, shift);
+  };
+
+  /*!
+     @brief  find a bucket in the circular buffer
+     @param l the level
+     @param i the position (0 = oldest)
+     @return the index of the bucket in bucket[l]
+  */
+  byte index(byte l, byte i) {
+    RT_ASSERT(l < levels, "!pyr1");
+    RT_ASSERT(i < lv_size[l], "!pyr2");
+    return (lv_index[l] + 1 + i) % lv_size[l];
+  };
+
+public:
+  /*!
+     @brief  clear all levels
+  */
+  void clear() {
+    for (byte l = 0; l < levels; l++)
+      lv_size[l] = 0;
+    for (byte j = 0; j <= levels; j++)
+      acc[j].n = 0;
+  };
+
+  /*!
+     @brief  add a value, updating all the levels as needed
+     @param x the value to add
+  */
+  void append(long x) {
+    float avg = x;
+    long min = x;
+    long max = x;
+    for (byte j = 0; j <= levels; j++) {
+      acc_type *a = &acc[j];
+      if (a->n == 0) {
+        a->sum = 0.0;
+        a->min = min;
+        a->max = max;
+      } else {
+        if (min < a->min)
+          a->min = min;
+        if (max > a->max)
+          a->max = max;
+      }
+      a->sum += avg;
+      if (++a->n < factor)
+        return;
+      a->n = 0;
+      avg = a->sum / factor;
+      min = a->min;
+      max = a->max;
+      if (j > 0)
+        store(j - 1, avg, min, max);
+    }
+  };
+
+  /*!
+     @brief  multiply all values by 10^k
+     @details used when the graph is rescaled, see
+     k197_stored_graph_type::rescale()
+     @param k the power of 10
+  */
+  void rescale(int8_t k) {
+    for (byte l = 0; l < levels; l++) {
+      for (byte g = 0; g * group_size < lv_size[l]; g++) {
+        byte first = g * group_size;
+        byte last = first + group_size < lv_size[l] ? first + group_size
+                                                    : lv_size[l];
+        byte shift = 0; // first pass: the shift for the new distances
+        for (byte i = first; i < last; i++) {
+          for (byte above = 0; above < 2; above++)
+            shift = fitShift(k197_value_type::scale(distance(l, i, above), k),
+                             shift);
+        }
+        for (byte i = first; i < last; i++) {
+          bucket_type *b = &bucket[l][i];
+          b->avg = k197_value_type::scale(b->avg, k);
+          b->env = envCodes(k197_value_type::scale(distance(l, i, false), k),
+                            k197_value_type::scale(distance(l, i, true), k),
+                            shift);
+        }
+        env_shift[l][g] = shift;
+      }
+    }
+    for (byte j = 0; j <= levels; j++) {
+      acc[j].sum = k197_value_type::toFloat(acc[j].sum, k);
+      acc[j].min = k197_value_type::scale(acc[j].min, k);
+      acc[j].max = k197_value_type::scale(acc[j].max, k);
+    }
+  };
+
+  /*!
+     @brief  get the number of buckets in a level
+     @param l the level
+     @return the number of buckets
+  */
+  byte getSize(byte l) { return lv_size[l]; };
+
+  /*!
+     @brief  get the number of values summarized by each bucket in a level
+     @param l the level
+     @return the number of values
+  */
+  uint16_t getBucketSamples(byte l) {
+    uint16_t n = factor * factor;
+    while (l-- > 0)
+      n *= factor;
+    return n;
+  };
+
+  /*!
+     @brief  get the average value of a bucket
+     @param l the level
+     @param i the position (0 = oldest)
+     @return the average value
+  */
+  long getAvg(byte l, byte i) { return bucket[l][index(l, i)].avg; };
+
+  /*!
+     @brief  get the min value of a bucket
+     @param l the level
+     @param i the position (0 = oldest)
+     @return the min value
+  */
+  long getMin(byte l, byte i) {
+    byte j = index(l, i);
+    return bucket[l][j].avg - distance(l, j, false);
+  };
+
+  /*!
+     @brief  get the max value of a bucket
+     @param l the level
+     @param i the position (0 = oldest)
+     @return the max value
+  */
+  long getMax(byte l, byte i) {
+    byte j = index(l, i);
+    return bucket[l][j].avg + distance(l, j, true);
+  };
+
+  /*!
+     @brief  compute the min value in a level
+     @param l the level
+     @return the min value, or 0 if the level is empty
+  */
+  long calcMin(byte l) {
+    if (lv_size[l] == 0)
+      return 0L;
+    long y = getMin(l, 0);
+    for (byte i = 1; i < lv_size[l]; i++) {
+      long yi = getMin(l, i);
+      if (yi < y)
+        y = yi;
+    }
+    return y;
+  };
+
+  /*!
+     @brief  compute the max value in a level
+     @param l the level
+     @return the max value, or 0 if the level is empty
+  */
+  long calcMax(byte l) {
+    if (lv_size[l] == 0)
+      return 0L;
+    long y = getMax(l, 0);
+    for (byte i = 1; i < lv_size[l]; i++) {
+      long yi = getMax(l, i);
+      if (yi > y)
+        y = yi;
+    }
+    return y;
+  };
 };
 
 /**************************************************************************/
@@ -498,7 +1687,7 @@ private:
   byte raw_dp = 0x00; ///< Stores the Decimal Point (bit 0 = not used, bit 1...7
                       ///< = DP bit for digit/char 0-6 of raw_msg)
 
-  float msg_value = 0.0; ///< numeric value of message
+  k197_value_type msg_value; ///< numeric value of message
 
   byte annunciators0 = 0x00; ///< Stores MINUS BAT RCL AC dB STO REL AUTO
   byte annunciators7 = 0x00; ///< Stores mA, k, V, u (micro), M, m (mV)
@@ -511,23 +1700,48 @@ private:
       @return true if DP was set, false otherwise
   */
   inline static bool hasDecimalPoint(byte b) { return (b & 0b00000100) != 0; };
+
+  float tcold = 0.0; ///< temperature used for cold junction compensation
+
+  unsigned long tstamp = 0UL; ///< acquisition time of the last frame (ms)
+  int16_t tperiod16 =
+      333 * 16; ///< measured K197 update period in 1/16 ms units (rolling
+                ///< average, initialized to the nominal 3 Hz)
+  byte tperiod_rejects = 0; ///< consecutive intervals rejected by
+                            ///< updateTimestamp()
+  static const byte max_tperiod_rejects =
+      4; ///< after this many rejected intervals, the average is reseeded
+  void updateTimestamp(unsigned long new_tstamp);
+
+public:
   /*!
-      @brief  check if a char is a digit or a space
-      @param c the char to check
-      @return true if the char represents a digit or a space
+     @brief  unit information decoded from the annunciators
   */
-  inline static bool isDigitOrSpace(char c) {
-    if (isDigit(c))
-      return true;
-    if (c == CH_SPACE)
-      return true;
-    return false;
+  struct k197_unit_type {
+    const char *unit;   ///< unit string (PROGMEM, UTF-8), see getUnit()
+    char munit;         ///< main unit, see getMainUnit()
+    int8_t pow10;       ///< exponent of the SI prefix, see getUnitPow10()
+    bool canBeNegative; ///< see valueCanBeNegative()
   };
 
-  float tcold = 0.0; ///< temperature used for cold junction compensation
+private:
+  k197_unit_type unit_desc; ///< the unit of the current measurement, always
+                            ///< set by updateUnit() (also in the constructor)
+  void updateUnit();
+
+  byte last_data[PACKET_DATA]; ///< copy of the last frame that was decoded
+  byte last_n = 0xff;          ///< size of last_data (0xff = invalid)
+  bool last_tkMode = false;    ///< tkMode when last_data was decoded
+  byte nhits_tk = 0;           ///< consecutive hits in TK mode
+  static const byte max_hits_tk = 15; ///< max consecutive hits in TK mode
+  unsigned long decode_hits = 0UL; ///< frames not decoded because identical
+                                   ///< to the previous one
 
   void setOverrange();
   void tkConvertV2C();
+  bool isSameFrame(byte *data, byte n);
+  void decodeFrame(byte *data, byte n);
+  byte processFrame(byte *data, byte n);
 
 public:
   /*!
@@ -537,6 +1751,7 @@ public:
   K197device() {
     raw_msg[0] = 0;
     cache.hold.raw_msg[0] = 0;
+    updateUnit(); // no annunciators yet: no unit
   };
   bool getNewReading();
   byte getNewReading(byte *data);
@@ -554,9 +1769,9 @@ public:
       @details when the full range is supported and a unit prefix changes (e.g.
      from mV to V) the data stored in the graph are scaled approipriately to
      match the new unit prefix (in the example above every value would be
-     multiplied by 1000) Note that this can result in a lack of precision for
-     the data already acquired (due to the fact double are not supported by the
-     AVR)
+     multiplied by 1000). The data already acquired is not modified, but some
+     resolution may be lost later if values with very different magnitude must
+     be stored in the graph (see k197_value_type)
       @return true if full range supported
   */
 
@@ -604,11 +1819,45 @@ public:
     return hold ? bitRead(cache.hold.raw_dp, char_n) : bitRead(raw_dp, char_n);
   };
 
-  const __FlashStringHelper *
-  getUnit(bool include_dB = false,
-          bool hold = false); // Note: includes UTF-8 characters
-  char getMainUnit();
-  int8_t getUnitPow10(bool hold = false);
+  /*!
+      @brief  return the unit, including SI prefix (V, mV, etc.)
+      @param include_dB if true, returns "dB" as a unit when in dB mode
+      @param hold if true returns the value at the time hold mode was last
+     entered
+      @return the unit (2 characters + terminating NUL). This is a UTF-8 string
+     because it may include Ω or µ
+  */
+  const __FlashStringHelper *getUnit(bool include_dB = false,
+                                     bool hold = false) {
+    if (hold)
+      return include_dB ? cache.hold.unit_with_db : cache.hold.unit;
+    if (!include_dB && unit_desc.munit == 'B')
+      return F("  ");
+    return reinterpret_cast<const __FlashStringHelper *>(unit_desc.unit);
+  };
+
+  /*!
+      @brief returns the main unit
+      @details this is not intended for external presentation, only for
+     internal housekeeping. The supported units are: 'C' (°C), 'V' (Volt), 'O'
+     (Ohm), 'A' (Ampere), 'B' (dB) and ' ' (unrecognized unit)
+      @returns a char corresponding to the main unit
+  */
+  char getMainUnit() { return unit_desc.munit; };
+
+  /*!
+      @brief returns the exponent corresponding to the SI multiplier
+      @details 10 elevated to the exponent returned gives the power of 10
+     corresponding to the prefix set in the annouciators For example, 1KΩ means
+     10^3Ω ==> exponent is 3. In 1µA means 10^-6A exponent is -6. with no prefix
+     0 is returned (10^0=1).
+      @param hold if true returns the value at the time hold mode was last
+     entered
+      @returns the exponent corresponding to the SI multiplier
+  */
+  int8_t getUnitPow10(bool hold = false) {
+    return hold ? cache.hold.pow10 : unit_desc.pow10;
+  };
 
   /*!
       @brief  check if overange is detected
@@ -642,11 +1891,57 @@ public:
      true) or 0.0 otherwise
   */
   float getValue(bool hold = false) {
-    return hold ? cache.hold.msg_value : msg_value;
+    return hold ? cache.hold.msg_value.getValue() : msg_value.getValue();
+  };
+
+  /*!
+      @brief  returns the acquisition time of the measurement
+      @details the time is captured in the SPI interrupt handler when the
+     K197/197A ends the transmission of the frame, so it is not affected by the
+     time spent in loop() before the data is processed. The time is read with
+     millis(), so the resolution is 1 ms (finer time stamps would need a TCB
+     input capture, which is not used)
+      @param hold if true returns the value at the time hold mode was last
+     entered
+      @return the value of millis() when the last measurement was received
+  */
+  unsigned long getFrameTimestamp(bool hold = false) {
+    return hold ? cache.hold.tstamp : tstamp;
   };
 
+  /*!
+      @brief  returns the measured update period of the K197/197A
+      @details this is calculated from the time stamps of the frames as they are
+     received (see getFrameTimestamp()). The nominal value is 1/3 s
+      @param hold if true returns the value at the time hold mode was last
+     entered
+      @return the time between two measurements in seconds
+  */
+  float getFramePeriod(bool hold = false) {
+    return (hold ? cache.hold.tperiod16 : tperiod16) * (1.0 / 16000.0);
+  };
+
+  /*!
+      @brief  returns the number of frames that were not decoded
+      @details when a frame is identical to the previous one, the decoded
+     information is reused. The frame is still used for statistics and graph
+      @return the number of frames that were not decoded since the start
+  */
+  unsigned long getDecodeHits() { return decode_hits; };
+
   void debugPrint();
 
+#ifdef SELF_TEST
+  void selfTest(Print &out);
+
+private:
+  float decodeReference(byte *data, byte n);
+  void benchmarkDecode(Print &out);
+  bool testResample(Print &out, uint16_t iterations);
+
+public:
+#endif // SELF_TEST
+
 private:
   static const byte max_graph_period =
       210; ///< maximum number of seconds between samples
@@ -657,42 +1952,96 @@ private:
   public:
     byte numInvalid =
         0; ///< Keep track of the times the cache is found to be invalid
-    float avg_factor = 1.0 / 3.0; ///< Factor used in average calculation
-    bool tkMode = false;          ///< caches tkMode from previous measurement
-    float msg_value = 0.0; ///< caches msg_value from previous measurement
+    bool tkMode = false; ///< caches tkMode from previous measurement
+    k197_value_type
+        msg_value; ///< caches msg_value from previous measurement
     byte annunciators0 =
         0x00;              ///< caches annunciators0 from previous measurement
     char munit = CH_SPACE; ///< Stores measurement unit (V, A, etc.)
     int8_t pow10 =
         0; ///< Stores the exponent corresponding to the prefix (m, K, etc.)
 
-    float average = 0.0; ///< keep track of the average
-    float min = 0.0;     ///< keep track of the minimum
-    float max = 0.0;     ///< keep track of the maximum
+    int8_t val_pow10 = 0; ///< average, min, max and graph values are stored
+                          ///< as integers, value = integer * 10^val_pow10
+    long average = 0L;    ///< keep track of the average
+    int16_t avg_rem = 0;  ///< remainder of the average calculation
+    long min = 0L;        ///< keep track of the minimum
+    long max = 0L;        ///< keep track of the maximum
+
+    unsigned long stat_n = 0UL; ///< number of samples (Welford's algorithm)
+    long stat_ref = 0L;         ///< first sample, stat_mean is relative to it
+    float stat_mean = 0.0; ///< arithmetic mean - stat_ref (same units as min)
+    float stat_m2 = 0.0;   ///< sum of squared differences from the mean
 
     k197_stored_graph_type graph; ///< stores the graph
+    k197_graph_pyramid_type graph_pyramid; ///< long term history
 
     byte nskip = 0;    ///< Skip counter for rolling average
     byte nsamples = 3; ///< Number of samples to use for rolling average
 
     uint16_t nskip_graph = 0;      ///< Skip counter for graph
     uint16_t nsamples_graph = 0;   ///< Number of samples to use for graph
+    byte graph_period = 0; ///< graph period (s) selected, see setGraphPeriod()
     bool autosample_graph = false; ///< if true set nsamples_graph automatically
+    bool average_graph = false; ///< if true graph the average of the samples
+
+    long box_ref = 0L;   ///< first sample of the group being averaged
+    float box_sum = 0.0; ///< sum of the samples in the group (minus box_ref)
+    long box_min = 0L;   ///< min of the samples in the group
+    long box_max = 0L;   ///< max of the samples in the group
+    uint16_t box_n = 0;  ///< number of samples in the group
+
+    /*!
+      @brief store the average of the group being averaged in the graph
+      @details the envelope of the new value includes all the samples in the
+      group. Nothing is stored if the group is empty
+    */
+    void flushBox() {
+      if (box_n == 0)
+        return;
+      float avg = box_sum / box_n;
+      graph.append(box_ref + (avg < 0.0 ? long(avg - 0.5) : long(avg + 0.5)));
+      graph.extendEnvelope(box_min);
+      graph.extendEnvelope(box_max);
+      box_n = 0;
+    };
 
     /*!
       @brief add one sample to graph
-      @details Only one out of every nsamples is stored
+      @details Only one out of every nsamples is stored in the graph, the
+      others extend the envelope of the last value stored. With average_graph
+      the samples are grouped instead, and the average of each group is stored
+      when the group is complete (see flushBox()). All are added to
+      graph_pyramid
       @param x the value to add (or skip, depending on nsamples and nskip_graph)
     */
-    void add2graph(float x) {
-      if (nskip_graph == 0) {
+    void add2graph(long x) {
+      graph_pyramid.append(x);
+      if (average_graph && (nskip_graph == 0 || box_n > 0)) {
+        if (box_n == 0) {
+          box_ref = box_min = box_max = x;
+          box_sum = 0.0;
+        } else if (x < box_min) {
+          box_min = x;
+        } else if (x > box_max) {
+          box_max = x;
+        }
+        box_sum += x - box_ref;
+        box_n++;
+        if (nskip_graph + 1 >= nsamples_graph)
+          flushBox();
+      } else if (nskip_graph == 0) {
         graph.append(x);
+      } else { // includes a group started before average_graph was set
+        graph.extendEnvelope(x);
       }
       if (++nskip_graph >= nsamples_graph)
         nskip_graph = 0;
     };
     void resetGraph();
     void resampleGraph(uint16_t nsamples_new);
+    long alignValue(k197_value_type v);
+    void setValPow10(int8_t new_pow10);
 
   public:
     /*!
@@ -702,11 +2051,18 @@ private:
       char raw_msg[K197_RAW_MSG_SIZE];        ///< holds raw_msg
       byte raw_dp = 0x00;                     ///< holds raw_dp
       byte annunciators0 = 0x00;              ///< holds annunciators0
-      float msg_value;                        ///< holds the measured value
+      k197_value_type msg_value;              ///< holds the measured value
       float tcold = 0.0;                      ///< holds tcold
-      float average = 0.0;                    ///< holds cache.average
-      float min = 0.0;                        ///< holds cache.min
-      float max = 0.0;                        ///< holds cache.max
+      unsigned long tstamp = 0UL;             ///< holds tstamp
+      int16_t tperiod16 = 0;                  ///< holds tperiod16
+      int8_t val_pow10 = 0;                   ///< holds cache.val_pow10
+      long average = 0L;                      ///< holds cache.average
+      long min = 0L;                          ///< holds cache.min
+      long max = 0L;                          ///< holds cache.max
+      unsigned long stat_n = 0UL;             ///< holds cache.stat_n
+      long stat_ref = 0L;                     ///< holds cache.stat_ref
+      float stat_mean = 0.0;                  ///< holds cache.stat_mean
+      float stat_m2 = 0.0;                    ///< holds cache.stat_m2
       char munit = CH_SPACE;                  ///< holds cache.munit
       const __FlashStringHelper *unit = NULL; ///< holds unit string
       const __FlashStringHelper *unit_with_db =
@@ -716,20 +2072,23 @@ private:
       bool isNumeric = false;      ///< holds true if numeric
 
       // The following data is needed to hold the entire graph
-      k197_stored_graph_type graph; ///< Holds the graph
+      k197_graph_snapshot_type graph; ///< Frozen view of cache.graph
       uint16_t nsamples_graph = 0;  ///< Holds the sample time
     } hold; ///< store values to be displayed in hold mode
   } cache;  ///< cache measured values and related status information
 
 private:
   bool isCacheInvalid(char munit, int8_t pow10);
+  void calcGraphSums(byte first_point, byte num_points, bool hold, long *ref,
+                     float *sum, float *sumsq);
   void updateCache();
 
 public:
   void fillGraphDisplayData(k197_display_graph_type *graphdata,
-                            k197graph_yscale_opt yopt, bool hold = false);
+                            k197graph_yscale_opt yopt, bool hold = false,
+                            byte level = 0, bool envelope = false);
   void resetStatistics();
-  void rescaleStatistics(float fconv);
+  void rescaleStatistics(int8_t dpow10);
 
   /*!
       @brief  set the number of samples for rolling average calculation
@@ -740,10 +2099,7 @@ public:
 
       @param nsamples number of samples
   */
-  void setNsamples(byte nsamples) {
-    cache.nsamples = nsamples;
-    cache.avg_factor = 1.0 / float(nsamples);
-  };
+  void setNsamples(byte nsamples) { cache.nsamples = nsamples; };
   /*!
       @brief get the number of samples for rolling average calculation
       @return number of samples
@@ -754,23 +2110,27 @@ public:
       @brief  set the sampling period for the graph in seconds
 
       @details the actual sapling time will approximate the requested time,
-     depending on the actual sampling rate of the K197. when set to zero, all
-     samples received from the K197 are graphed (the data rate is about 3Hz)
+     depending on the measured sampling rate of the K197 (see
+     getFramePeriod()). when set to zero, all samples received from the K197 are
+     graphed (the data rate is about 3Hz)
 
       @param nseconds sampling time in seconds
   */
   void setGraphPeriod(byte nseconds) {
-    uint16_t nsamples_new = nseconds * 3;
+    uint16_t nsamples_new = float(nseconds) / getFramePeriod() + 0.5;
+    cache.graph_period = nseconds;
     cache.resampleGraph(nsamples_new);
   };
   /*!
       @brief get the sampling period for the graph in seconds
-      @details the actual sapling time will approximate the returned time,
-     depending on the actual sampling rate of the K197. When zero is returned,
-     all samples received from the K197 are graphed (the data rate is about 3Hz)
+      @details this is the value last set with setGraphPeriod() (also by
+     autosample), rather than a value calculated from the measured sampling
+     rate of the K197, that can change a little with every frame. When zero is
+     returned, all samples received from the K197 are graphed (the data rate is
+     about 3Hz)
       @return number the sampling period in seconds
   */
-  uint16_t getGraphPeriod() { return cache.nsamples_graph / 3; };
+  uint16_t getGraphPeriod() { return cache.graph_period; };
 
   /*!
       @brief get the graph size (number of data points in the graph)
@@ -790,9 +2150,43 @@ public:
       @return the value of the graph at point n
   */
   float getGraphValue(byte n, bool hold = false) {
-    return hold ? cache.hold.graph.get(n) : cache.graph.get(n);
+    return hold ? k197_value_type::toFloat(cache.hold.graph.get(n),
+                                           cache.hold.val_pow10)
+                : k197_value_type::toFloat(cache.graph.get(n), cache.val_pow10);
   };
   float getGraphAverage(byte first_point, byte num_points, bool hold = false);
+  float getGraphRMS(byte first_point, byte num_points, bool hold = false);
+  float getGraphStdDev(byte first_point, byte num_points, bool hold = false);
+
+  /*!
+      @brief get the minimum of the last part of the graph
+      @param first_point the first point to consider (0 = oldest)
+      @param hold if true returns the value at the time hold mode was last
+     entered
+      @return the minimum value from first_point to the newest point
+  */
+  float getGraphMin(byte first_point = 0, bool hold = false) {
+    return hold ? k197_value_type::toFloat(
+                      cache.hold.graph.calcMin(first_point),
+                      cache.hold.val_pow10)
+                : k197_value_type::toFloat(cache.graph.calcMin(first_point),
+                                           cache.val_pow10);
+  };
+
+  /*!
+      @brief get the maximum of the last part of the graph
+      @param first_point the first point to consider (0 = oldest)
+      @param hold if true returns the value at the time hold mode was last
+     entered
+      @return the maximum value from first_point to the newest point
+  */
+  float getGraphMax(byte first_point = 0, bool hold = false) {
+    return hold ? k197_value_type::toFloat(
+                      cache.hold.graph.calcMax(first_point),
+                      cache.hold.val_pow10)
+                : k197_value_type::toFloat(cache.graph.calcMax(first_point),
+                                           cache.val_pow10);
+  };
 
   /*!
       @brief  set the autosample flag
@@ -811,6 +2205,26 @@ public:
   */
   bool getAutosample() { return cache.autosample_graph; };
 
+  /*!
+      @brief  set the graph averaging mode
+      @details when true, each value stored in the graph is the average of all
+     the measurements in the sampling period, rather than the first one (see
+     setGraphPeriod()). This avoids aliasing when the sampling period is
+     longer than the K197 update period. The values stored already are not
+     changed
+      @param average true to store the average
+  */
+  void setGraphAveraging(bool average) {
+    cache.flushBox();
+    cache.average_graph = average;
+  };
+  /*!
+      @brief get the graph averaging mode
+      @details see setGraphAveraging()
+      @return true if the graph stores the average
+  */
+  bool isGraphAveraging() { return cache.average_graph; };
+
   /*!
       @brief  returns the average value (see also setNsamples())
       @param hold if true returns the value at the time hold mode was last
@@ -818,7 +2232,9 @@ public:
       @return average value
   */
   float getAverage(bool hold = false) {
-    return hold ? cache.hold.average : cache.average;
+    return hold ? k197_value_type::toFloat(cache.hold.average,
+                                           cache.hold.val_pow10)
+                : k197_value_type::toFloat(cache.average, cache.val_pow10);
   };
 
   /*!
@@ -827,7 +2243,10 @@ public:
      entered
       @return minimum value
   */
-  float getMin(bool hold = false) { return hold ? cache.hold.min : cache.min; };
+  float getMin(bool hold = false) {
+    return hold ? k197_value_type::toFloat(cache.hold.min, cache.hold.val_pow10)
+                : k197_value_type::toFloat(cache.min, cache.val_pow10);
+  };
 
   /*!
       @brief  returns the maximum value
@@ -835,13 +2254,39 @@ public:
      entered
       @return maximum value
   */
-  float getMax(bool hold = false) { return hold ? cache.hold.max : cache.max; };
+  float getMax(bool hold = false) {
+    return hold ? k197_value_type::toFloat(cache.hold.max, cache.hold.val_pow10)
+                : k197_value_type::toFloat(cache.max, cache.val_pow10);
+  };
 
   /*!
-    @brief  returns the maximum value
-    @param hold if true returns the value at the time hold mode was last entered
-    @return maximum value
-*/
+      @brief  returns the number of samples used for getMean() and getStdDev()
+      @param hold if true returns the value at the time hold mode was last
+     entered
+      @return number of samples since the statistics were last reset
+  */
+  unsigned long getCount(bool hold = false) {
+    return hold ? cache.hold.stat_n : cache.stat_n;
+  };
+
+  /*!
+      @brief  returns the arithmetic mean of all the samples
+      @details unlike getAverage() this is not a rolling average, all samples
+     since the statistics were last reset have the same weight
+      @param hold if true returns the value at the time hold mode was last
+     entered
+      @return the mean value
+  */
+  float getMean(bool hold = false) {
+    return hold ? k197_value_type::toFloat(cache.hold.stat_ref +
+                                               cache.hold.stat_mean,
+                                           cache.hold.val_pow10)
+                : k197_value_type::toFloat(cache.stat_ref + cache.stat_mean,
+                                           cache.val_pow10);
+  };
+
+  float getVariance(bool hold = false);
+  float getStdDev(bool hold = false);
 
 public:
   // annunciators0
@@ -1001,13 +2446,13 @@ public:
       @return returns true if the value can be negative, false otherwise
   */
   inline bool valueCanBeNegative(bool hold = false) {
+    if (!hold)
+      return unit_desc.canBeNegative; // see updateUnit()
     if (isREL(hold))
       return true; // Relative values can always be negative
     if (isAC(hold))
       return false; // AC cannot be negative (unless isREL())
-    if (hold)
-      return cache.hold.munit == 'O' ? false : true; // Ohm cannot be negative
-    return cache.munit == 'O' ? false : true;        // Ditto
+    return cache.hold.munit == 'O' ? false : true; // Ohm cannot be negative
   }
 
   // Extra modes/annnunciators not available on original K197
@@ -1018,7 +2463,10 @@ public:
       is converted to a temperature value assuming a k thermocouple is connected
       @param mode true if enabled, false if disabled
   */
-  void setTKMode(bool mode) { flags.tkMode = mode; }
+  void setTKMode(bool mode) {
+    flags.tkMode = mode;
+    updateUnit();
+  }
 
   /*!
       @brief  get Thermocuple mode (see also setTKMode())
@@ -38,6 +38,13 @@
   Both strategies have pro and cons. As of now, both strategies work equally
   well. Both options are available as one or the other may work better for users
   that want to customize this sketch for their specific needs
+
+  Each frame is time stamped when the SS pin goes high (end of the frame). The
+  time stamp is read from the free running TCB used by dxCore for millis(),
+  so it reflects the acquisition time and not the time when loop() gets around
+  to process the frame. With interrupts the time stamp is taken in the pin
+  change interrupt handler, with polling it is only as precise as the polling
+  interval.
 */
 /**************************************************************************/
 
@@ -57,16 +64,76 @@
 static volatile byte nbyte =
     0x00; ///< keep track of characters received from the SPI client
 #endif
-//#define SPIflags GPIOR3 //uncomment to use GPIOR3 to speed up interrupt
-// handler slightly
-#ifndef SPIflags
-static volatile byte SPIflags =
-    0x00; ///< Various flags used in interupt handlers
-#endif
-#define SPIdone                                                                \
-  0x02 ///< flag used to signal that all SPI data have been received
 
-volatile byte spiBuffer[PACKET_DATA]; ///< buffer used to receive data from SPI
+#define SPI_FRAME_MASK                                                         \
+  (SPI_FRAME_SLOTS - 1) ///< mask used to convert a frame counter to a slot
+#define SPI_FRAME_DISCARD                                                      \
+  0xff ///< value of nbyte used to signal that the current frame is discarded
+
+// The frames are stored in a single producer/single consumer ring buffer. The
+// producer is the SPI interrupt handlers (or hasNewData() when polling), the
+// consumer is getNewData(). frame_head is only modified by the producer and
+// frame_tail is only modified by the consumer, so no locking is needed. Both
+// are free running counters: (frame_head - frame_tail) is the number of frames
+// waiting to be read. Since they are byte variables, reading and writing them
+// is atomic.
+volatile spi_frame_type
+    spiFrames[SPI_FRAME_SLOTS]; ///< ring buffer used to receive data from SPI
+static volatile byte frame_head =
+    0x00; ///< counts the frames stored in spiFrames (free running)
+static volatile byte frame_tail =
+    0x00; ///< counts the frames read from spiFrames (free running)
+static volatile byte frame_seq =
+    0x00; ///< sequence number that will be assigned to the next frame
+static volatile uint16_t frames_dropped =
+    0x00; ///< number of frames lost because all slots were in use
+static volatile uint16_t frames_received =
+    0x00; ///< number of frames stored in spiFrames
+
+/*!
+  @brief  utility function, prepare to receive a new frame
+  @details if there is no free slot, nbyte is set to SPI_FRAME_DISCARD so that
+  the data of the new frame is not stored (the slot at frame_head is still in
+  use by the consumer in this case)
+*/
+static inline void frameStart() {
+  if ((byte)(frame_head - frame_tail) >= SPI_FRAME_SLOTS) {
+    nbyte = SPI_FRAME_DISCARD;
+  } else {
+    nbyte = 0;
+  }
+}
+
+/*!
+  @brief  utility function, store a data byte in the current frame
+  @param c the data byte to store
+*/
+static inline void frameStore(byte c) {
+  if (nbyte < PACKET_DATA) {
+    spiFrames[frame_head & SPI_FRAME_MASK].data[nbyte] = c;
+    nbyte++;
+  }
+}
+
+/*!
+  @brief  utility function, commit the current frame to the ring buffer
+  @details a discarded frame is not committed, it is counted in frames_dropped
+  instead. Either way the frame consumes a sequence number.
+*/
+static inline void frameEnd() {
+  if (nbyte == SPI_FRAME_DISCARD) {
+    frames_dropped++;
+  } else {
+    volatile spi_frame_type *frame = &spiFrames[frame_head & SPI_FRAME_MASK];
+    frame->nbyte = nbyte;
+    frame->seq = frame_seq;
+    frame->tstamp = millis();
+    frame_head++;
+    frames_received++;
+  }
+  frame_seq++;
+  frameStart(); // we do not know yet if we will see the SS falling edge
+}
 
 #ifdef DEVICE_USE_INTERRUPT
 /*!
@@ -80,10 +147,10 @@ volatile byte spiBuffer[PACKET_DATA]; ///< buffer used to receive data from SPI
 ISR(SPI1_PORT_vect) {                // __vector_30
   SPI1_VPORT.INTFLAGS |= SPI1_SS_bm; // clears interrupt flag
   if (SPI1_VPORT.IN & SPI1_SS_bm) {  // device de-selected
-    SPIflags |= SPIdone;
+    frameEnd();
   } else { // device selected
     cli();
-    nbyte = 0;
+    frameStart();
     sei();
   }
 }
@@ -94,8 +161,12 @@ ISR(SPI1_PORT_vect) {                // __vector_30
    member function
 */
 void SPIdevice::setup() {
-  nbyte = 0x00;
-  SPIflags = 0x00;
+  frame_head = 0x00;
+  frame_tail = 0x00;
+  frame_seq = 0x00;
+  frames_dropped = 0x00;
+  frames_received = 0x00;
+  frameStart();
   pinMode(SPI1_MOSI, INPUT);
   pinMode(MB_CD, INPUT); // Command/Data input - It is configured as inpout, so
                          // it won't be used as MISO by the SPI in slave mode
@@ -149,7 +220,7 @@ void SPIdevice::setup() {
 */
 bool SPIdevice::hasNewData() {
 #ifdef DEVICE_USE_INTERRUPT
-  return SPIflags & SPIdone;
+  return frame_head != frame_tail;
 #else  // No interrupt - this means we need to poll the SPI registers & do all
        // the work here!
   static bool SS_active = false;
@@ -157,26 +228,23 @@ bool SPIdevice::hasNewData() {
     while (SPI1.INTFLAGS & SPI_RXCIF_bm) { // we have new SPI1.DATA
       volatile byte c =
           SPI1.DATA; // Note: this also clears RXCIF if the buffer is empty
-      if (nbyte < PACKET_DATA) {
-        if (SPI1_VPORT.IN & MB_CD_bm) { // this is a command, skip
-                                        // DO Nothing
-        } else {                        // this instead is data
-          spiBuffer[nbyte] = c;
-          nbyte++;
-        }
+      if (SPI1_VPORT.IN & MB_CD_bm) { // this is a command, skip
+                                      // DO Nothing
+      } else {                        // this instead is data
+        frameStore(c);
       }
     }
     if (SPI1_VPORT.IN & SPI1_SS_bm) { // device has been de-selected
-      SPIflags |= SPIdone;
+      frameEnd();
       SS_active = false;
     }
   } else {
     if ((SPI1_VPORT.IN & SPI1_SS_bm) == 0x00) { // device has been selected
       SS_active = true;
-      nbyte = 0;
+      frameStart();
     }
   }
-  return SPIflags & SPIdone;
+  return frame_head != frame_tail;
 #endif // DEVICE_USE_INTERRUPT
 }
 
@@ -187,6 +255,10 @@ bool SPIdevice::hasNewData() {
      @details If a number != 9 is returned, indicates that the data was NOT
    correctly transmitted
 
+   Frames are returned in the order they have been received, one for each call.
+   If more than one frame is waiting, hasNewData() will still return true after
+   this call.
+
    Note that this method will block until hasNewData() returns true.
    If the caller doesn't want to block execution, it has to check hasNewData()
    before calling getNewData()
@@ -196,15 +268,76 @@ bool SPIdevice::hasNewData() {
       @return the number of bytes copied into data.
 */
 byte SPIdevice::getNewData(byte *data) {
-  byte returnvalue;
   while (!hasNewData()) {
     ;
   }
-  memcpy(data, (void *)spiBuffer, PACKET_DATA);
+  volatile spi_frame_type *frame = &spiFrames[frame_tail & SPI_FRAME_MASK];
+  for (byte i = 0; i < PACKET_DATA; i++) {
+    data[i] = frame->data[i];
+  }
+  byte returnvalue = frame->nbyte;
+  frame_tail++; // the slot can now be reused by the producer
+  return returnvalue;
+}
+
+/*!
+      @brief retrieve all the frames received via SPI and not yet processed
+
+     @details the frames are copied in the order they have been received
+   (frames[0] is the oldest). This is useful to catch up after the main loop has
+   been busy for longer than the K197 update period.
+
+   Note that this method will block until hasNewData() returns true.
+   If the caller doesn't want to block execution, it has to check hasNewData()
+   before calling getNewData()
+
+      @param frames array that will receive the copy of the frames. MUST have
+   room for at least max_frames elements!
+      @param max_frames the maximum number of frames to copy
+      @return the number of frames copied into frames.
+*/
+byte SPIdevice::getNewData(spi_frame_type *frames, byte max_frames) {
+  while (!hasNewData()) {
+    ;
+  }
+  byte n = 0;
+  while (n < max_frames && hasNewData()) {
+    frames[n].seq = spiFrames[frame_tail & SPI_FRAME_MASK].seq;
+    frames[n].tstamp = spiFrames[frame_tail & SPI_FRAME_MASK].tstamp;
+    frames[n].nbyte = getNewData(frames[n].data);
+    n++;
+  }
+  return n;
+}
+
+/*!
+      @brief get the number of frames received and not yet processed
+      @return the number of frames waiting in the buffer
+*/
+byte SPIdevice::framesPending() { return (byte)(frame_head - frame_tail); }
+
+/*!
+      @brief get the number of frames that have been lost
+      @details a frame is lost when it is received while all SPI_FRAME_SLOTS
+   slots are still waiting to be processed
+      @return the number of frames dropped since setup()
+*/
+uint16_t SPIdevice::framesDropped() {
+  cli();
+  uint16_t returnvalue = frames_dropped;
+  sei();
+  return returnvalue;
+}
+
+/*!
+      @brief get the number of frames that have been received
+      @details only the frames stored in the buffer are counted, the frames
+   sent by the K197 are framesReceived() + framesDropped()
+      @return the number of frames received since setup()
+*/
+uint16_t SPIdevice::framesReceived() {
   cli();
-  SPIflags &= (~SPIdone);
-  returnvalue = nbyte;
-  nbyte = 0;
+  uint16_t returnvalue = frames_received;
   sei();
   return returnvalue;
 }
@@ -248,14 +381,13 @@ ISR(SPI1_INT_vect) { // __vector_37  TODO: read all available bytes in one go
   while (SPI1.INTFLAGS & SPI_RXCIF_bm) {
     volatile byte c =
         SPI1.DATA; // Note: this also clears RXCIF if the buffer is empty
-    if (nbyte >= PACKET_DATA) {
+    if (nbyte >= PACKET_DATA) { // frame complete or discarded
       return;
     }
     if (SPI1_VPORT.IN & MB_CD_bm) { // this is a command, skip
                                     // DO Nothing
     } else {                        // this instead is data
-      spiBuffer[nbyte] = c;
-      nbyte++;
+      frameStore(c);
     }
   }
 }
@@ -27,10 +27,28 @@ extern const char
 //#define PACKET 18      ///< our SPI packet is 18 bytes max
 #define PACKET_DATA 9 ///< size of the packet when it contains normal data
 
+#define SPI_FRAME_SLOTS                                                        \
+  4 ///< number of frames that can be queued before data is lost. Must be a
+    ///< power of 2 (2, 4, 8, ...)
+
 #define DEVICE_USE_INTERRUPT ///< when defined, the code will use interrupt to
                              ///< interface to the SPI peripheral. Otherwise it
                              ///< will use polling.
 
+/**************************************************************************/
+/*!
+    @brief  structure used to store one frame received via SPI
+*/
+/**************************************************************************/
+struct spi_frame_type {
+  byte data[PACKET_DATA]; ///< data bytes received (commands are discarded)
+  byte nbyte;             ///< number of data bytes received
+  byte seq; ///< sequence number, incremented for each frame (including the
+            ///< frames that have been dropped)
+  unsigned long tstamp; ///< millis() when the frame was completed (SS rising
+                        ///< edge)
+};
+
 /**************************************************************************/
 /*!
     @brief  Simple class to handle a cluster of buttons.
@@ -48,9 +66,13 @@ public:
   SPIdevice(){};
   void setup();
   bool hasNewData();
-  byte getNewData(byte *data); // This function must be called as soon as
+  byte getNewData(byte *data); // This function should be called as soon as
                                // hasNewData() returns true, otherwise data may
-                               // be ovewritten by the next update
+                               // be lost when all frame slots are in use
+  byte getNewData(spi_frame_type *frames, byte max_frames);
+  byte framesPending();
+  uint16_t framesDropped();
+  uint16_t framesReceived();
   void debugPrintData(byte *data, byte n = PACKET_DATA);
 
   /*!
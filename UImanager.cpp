@@ -43,6 +43,18 @@
 
 #include <Arduino.h>
 #include <U8g2lib.h>
+#ifdef __AVR__
+#include <util/crc16.h>
+#else // same as the avr-libc implementation, for cores without
+      // <util/crc16.h> (dtostrf() and the PROGMEM functions must still be
+      // provided by the core)
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data) {
+  data ^= crc & 0xff;
+  data ^= data << 4;
+  return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^
+          ((uint16_t)data << 3));
+}
+#endif // __AVR__
 
 #define DEFAULT_CONTRAST                                                       \
   0x00 ///< defines the default contrast. Can be changed via serial port
@@ -123,6 +135,75 @@ void drawDottedHLine(uint16_t x0, uint16_t y0, uint16_t x1,
   } while (x0 <= x1);
 }
 
+/*!
+    @brief utility function: scroll and clear columns in the display buffer
+    @details works directly on the u8g2 full buffer, where each row of tiles
+   is 8 pixels high and has one byte for each column. In each row of tiles the
+   columns from x0 to x1-1 are shifted left by shift columns, then the columns
+   from xclear to x1-1 are cleared
+    @param x0 Coordinate x of the first column
+    @param x1 Coordinate x of the column after the last one
+    @param shift the number of columns to shift (0 = no shift)
+    @param xclear Coordinate x of the first column to clear
+*/
+void scrollBufferColumns(uint16_t x0, uint16_t x1, uint16_t shift,
+                         uint16_t xclear) {
+  uint8_t *row = u8g2.getBufferPtr();
+  uint16_t row_size = u8g2.getBufferTileWidth() * 8;
+  for (uint8_t r = 0; r < u8g2.getBufferTileHeight(); r++, row += row_size) {
+    if (shift > 0 && shift < x1 - x0)
+      memmove(row + x0, row + x0 + shift, x1 - x0 - shift);
+    if (xclear < x1)
+      memset(row + xclear, 0, x1 - xclear);
+  }
+}
+
+/*!
+    @brief utility function: save or restore a rectangle of the display buffer
+    @details works directly on the u8g2 full buffer (see scrollBufferColumns),
+   one bit for each pixel
+    @param x Coordinate x of the first column
+    @param y Coordinate y of the first line
+    @param w width
+    @param h height
+    @param bits where the pixels are saved
+    @param bit index in bits of the first pixel
+    @param restore if true the pixels are copied from bits to the buffer
+*/
+static void copyBufferBits(byte x, byte y, byte w, byte h, byte *bits,
+                           uint16_t bit, bool restore) {
+  uint8_t *buf = u8g2.getBufferPtr();
+  uint16_t row_size = u8g2.getBufferTileWidth() * 8;
+  for (byte j = y; j < y + h; j++) {
+    uint8_t *p = buf + (j / 8) * row_size + x;
+    uint8_t mask = 1 << (j % 8);
+    for (byte i = 0; i < w; i++, p++, bit++) {
+      byte *b = &bits[bit / 8];
+      byte bmask = 1 << (bit % 8);
+      if (restore)
+        *p = (*b & bmask) ? (*p | mask) : (*p & ~mask);
+      else
+        *b = (*p & mask) ? (*b | bmask) : (*b & ~bmask);
+    }
+  }
+}
+
+/*!
+    @brief utility function: checksum of a block of the display buffer
+    @details CRC-16 (CCITT), so that any change of up to 16 consecutive bits is
+   detected. Simple sums are not enough here: a short horizontal line can sum
+   to zero modulo 256. Other changes can still be missed, see markDirtyTiles()
+    @param p pointer to the first byte
+    @param n number of bytes
+    @return the checksum
+*/
+static uint16_t bufferChecksum(const uint8_t *p, uint8_t n) {
+  uint16_t crc = 0xffff;
+  while (n-- > 0)
+    crc = _crc_ccitt_update(crc, *p++);
+  return crc;
+}
+
 // ***************************************************************************************
 // UI Setup
 // ***************************************************************************************
@@ -166,8 +247,10 @@ void UImanager::setup() {
   u8g2log.begin(U8LOG_WIDTH, U8LOG_HEIGHT, u8log_buffer);
 
   u8g2.clearBuffer();
+  graph_area_valid = false;
   setup_draw();
   u8g2.sendBuffer();
+  discardDirtyTiles();
 
   setupMenus();
 }
@@ -186,11 +269,25 @@ void UImanager::setup() {
 
     If you want to add an initial scren/text, the best way would be to add this
    to setup();
+
+   The buffer is sent to the display by pollDisplay(), which should be called
+   from loop(). Any part of the previous update not yet sent is sent before
+   drawing the new one.
    @param stepDoodle if true and the doodle animation is enabled, the animation
    is updated
 */
 void UImanager::updateDisplay(bool stepDoodle) {
-  u8g2.clearBuffer(); // Clear display area
+  flushDisplay();
+  PROFILE_scope(DebugOut.PROFILE_DISPLAY);
+  unsigned long t0 = micros();
+  if (graph_area_valid && k197dev.isNotCal() && isFullScreen() &&
+      getScreenMode() == K197sc_graph) { // see updateGraphScreen()
+    scrollBufferColumns(k197_display_graph_type::x_size, display_size_x, 0,
+                        k197_display_graph_type::x_size);
+  } else {
+    u8g2.clearBuffer(); // Clear display area
+    graph_area_valid = false;
+  }
 
   if (k197dev.isNotCal() && isSplitScreen())
     updateSplitScreen();
@@ -202,7 +299,133 @@ void UImanager::updateDisplay(bool stepDoodle) {
     updateGraphScreen();
 
   displayDoodle(doodle_x_coord, doodle_y_coord, stepDoodle);
-  u8g2.sendBuffer();
+  render_time = micros() - t0;
+  if (render_time > render_time_max)
+    render_time_max = render_time;
+  markDirtyTiles();
+  CHECK_FREE_STACK();
+}
+
+/*!
+    @brief  find the parts of the buffer that changed since the last update
+    @details the buffer is divided in groups of tile_group_size tiles of 8x8
+   pixels. The checksum of each group is compared with the checksum of the data
+   queued last time, and the groups that changed are marked to be sent by
+   pollDisplay(). All the groups are marked when the checksums are not valid
+   (e.g. after clearScreen()).
+
+   Two different contents can have the same checksum, so a change can be
+   missed. To recover from this, one row of tiles (refresh_row) is sent every
+   time, whether it changed or not. The next row is sent the next time, so
+   a missed change stays on the display for at most tile_rows updates.
+
+   The buffer must not change until the transfer is complete, see
+   flushDisplay()
+*/
+void UImanager::markDirtyTiles() {
+  const uint8_t *row = u8g2.getBufferPtr();
+  for (byte ty = 0; ty < tile_rows; ty++, row += display_size_x) {
+    byte mask = 0;
+    for (byte g = 0; g < tile_groups; g++) {
+      uint16_t sum =
+          bufferChecksum(row + g * tile_group_size * 8, tile_group_size * 8);
+      if (!tile_checksum_valid || sum != tile_checksum[ty][g])
+        mask |= 1 << g;
+      tile_checksum[ty][g] = sum;
+    }
+    tile_dirty[ty] = mask;
+  }
+  tile_dirty[refresh_row] = (1 << tile_groups) - 1;
+  if (++refresh_row >= tile_rows)
+    refresh_row = 0;
+  tile_checksum_valid = true;
+  xfer_row = 0;
+  xfer_bytes = 0;
+  xfer_time = 0UL;
+}
+
+/*!
+    @brief  forget any pending transfer
+    @details used when the whole buffer has just been sent with sendBuffer()
+*/
+void UImanager::discardDirtyTiles() {
+  memset(tile_dirty, 0, sizeof(tile_dirty));
+  xfer_row = tile_rows;
+  tile_checksum_valid = false;
+}
+
+/*!
+    @brief  send the next part of the last update to the display
+    @details sends the groups marked by markDirtyTiles() in the next row of
+   tiles, with one call to updateDisplayArea() for each run of consecutive
+   groups. Sending a full row takes less than 1ms, so calling this function
+   from loop() keeps the loop responsive while the display is updated.
+
+   The amount of data and the time spent are recorded, see getTransferBytes()
+   and getTransferTime()
+   @return true if the transfer is complete (see also isDisplayIdle())
+*/
+bool UImanager::pollDisplay() {
+  if (isDisplayIdle())
+    return true;
+  PROFILE_scope(DebugOut.PROFILE_SEND);
+  unsigned long t0 = micros();
+  byte mask = tile_dirty[xfer_row];
+  byte first = tile_groups; // first group of the current run
+  for (byte g = 0; g <= tile_groups; g++) {
+    bool dirty = (g < tile_groups) && (mask & (1 << g));
+    if (dirty && first == tile_groups) {
+      first = g;
+    } else if (!dirty && first < tile_groups) {
+      byte tw = (g - first) * tile_group_size;
+      u8g2.updateDisplayArea(first * tile_group_size, xfer_row, tw, 1);
+      xfer_bytes += tw * bytes_per_tile;
+      first = tile_groups;
+    }
+  }
+  tile_dirty[xfer_row] = 0;
+  xfer_row++;
+  unsigned long dt = micros() - t0;
+  xfer_time += dt;
+  if (dt > xfer_time_max)
+    xfer_time_max = dt;
+  return isDisplayIdle();
+}
+
+/*!
+    @brief  send what is left of the last update to the display
+    @details called before drawing in the buffer, so that the data still to be
+   sent is not modified. This only blocks when the previous update has not
+   been completed by pollDisplay()
+*/
+void UImanager::flushDisplay() {
+  while (!pollDisplay())
+    ;
+}
+
+/*!
+    @brief  print the content of the buffer as a plain PBM image
+    @details the output can be saved to a .pbm file and viewed or compared
+   with a reference image without access to the OLED (1 = pixel on). The
+   buffer contains the last update, whether or not it has been sent already.
+   This function blocks until the whole image has been printed
+    @param out the stream to print to (normally Serial)
+*/
+void UImanager::printScreen(Print &out) {
+  out.println(F("P1"));
+  out.print(display_size_x);
+  out.print(CH_SPACE);
+  out.println(display_size_y);
+  const uint8_t *buffer = u8g2.getBufferPtr();
+  for (u8g2_uint_t y = 0; y < display_size_y; y++) {
+    const uint8_t *row = buffer + (y / 8) * display_size_x;
+    byte mask = 1 << (y % 8);
+    for (u8g2_uint_t x = 0; x < display_size_x; x++) {
+      out.write((row[x] & mask) ? '1' : '0');
+      if (x % 64 == 63) // PBM lines should not exceed 70 characters
+        out.println();
+    }
+  }
   CHECK_FREE_STACK();
 }
 
@@ -397,6 +620,8 @@ void UImanager::updateMinMaxScreen() {
   const unsigned int ystat = 5;   // y coordinate for the statistics (1st line)
   const unsigned int xunit = 229; // x coordinate for the unit
   const unsigned int yunit = 20;  // y coordinate for the unit
+  const unsigned int xmean = 162; // x coordinate for mean, sdev and n: right
+                                  // of the annunciators (32 chars at y=53)
 
   bool hold = k197dev.getDisplayHold();
 
@@ -455,6 +680,22 @@ void UImanager::updateMinMaxScreen() {
   u8g2.setCursor(x, y);
   u8g2.print(formatNumber(buf, k197dev.getMin(hold)));
 
+  // Write mean, standard deviation and number of samples
+  u8g2.setFont(u8g2_font_5x7_mr);
+  x = xmean;
+  y = 40;
+  u8g2.setCursor(x, y);
+  u8g2.print(F("Mean "));
+  u8g2.print(formatNumber(buf, k197dev.getMean(hold)));
+  y += 8;
+  u8g2.setCursor(x, y);
+  u8g2.print(F("SDev "));
+  u8g2.print(formatNumber(buf, k197dev.getStdDev(hold)));
+  y += 8;
+  u8g2.setCursor(x, y);
+  u8g2.print(F("N    "));
+  u8g2.print(k197dev.getCount(hold));
+
   x = 170;
   y = 2;
   u8g2.setCursor(x, y);
@@ -556,7 +797,9 @@ void UImanager::setScreenMode(K197screenMode mode) {
 */
 void UImanager::clearScreen() {
   u8g2.clearBuffer();
+  graph_area_valid = false;
   u8g2.sendBuffer();
+  discardDirtyTiles();
   CHECK_FREE_STACK();
 }
 
@@ -642,8 +885,11 @@ DEF_MENU_OPTION(opt_gr_type_lines, OPT_GRAPH_TYPE_LINES, 0,
                 "Lines"); ///< Menu input
 DEF_MENU_OPTION(opt_gr_type_dots, OPT_GRAPH_TYPE_DOTS, 1,
                 "Dots"); ///< Menu input
+DEF_MENU_OPTION(opt_gr_type_envelope, OPT_GRAPH_TYPE_ENVELOPE, 2,
+                "Min/max"); ///< Menu input
 DEF_MENU_OPTION_INPUT(opt_gr_type, 15, "Graph type", OPT(opt_gr_type_lines),
-                      OPT(opt_gr_type_dots)); ///< Menu input
+                      OPT(opt_gr_type_dots),
+                      OPT(opt_gr_type_envelope)); ///< Menu input
 
 DEF_MENU_SEPARATOR(graphSeparator1, 15, "< Y axis >"); ///< Menu separator
 DEF_MENU_BOOL_ACT(gr_yscale_full_range, 15, "Full range",
@@ -675,13 +921,25 @@ DEF_MENU_BYTE_SETGET(gr_sample_time, 15, "Sample time (s)",
                      k197dev.setGraphPeriod(newValue);
                      ,
                      return k197dev.getGraphPeriod();); ///< Menu input
+DEF_MENU_BOOL_ACT(gr_xscale_average, 15, "Average samples",
+                  k197dev.setGraphAveraging(getValue());); ///< Menu input
+DEF_MENU_OPTION(opt_gr_span_1x, OPT_GRAPH_SPAN_1X, 0, "1x"); ///< Menu input
+DEF_MENU_OPTION(opt_gr_span_4x, OPT_GRAPH_SPAN_4X, 1, "4x"); ///< Menu input
+DEF_MENU_OPTION(opt_gr_span_16x, OPT_GRAPH_SPAN_16X, 2,
+                "16x"); ///< Menu input
+DEF_MENU_OPTION(opt_gr_span_64x, OPT_GRAPH_SPAN_64X, 3,
+                "64x"); ///< Menu input
+DEF_MENU_OPTION_INPUT(opt_gr_span, 15, "Time span", OPT(opt_gr_span_1x),
+                      OPT(opt_gr_span_4x), OPT(opt_gr_span_16x),
+                      OPT(opt_gr_span_64x)); ///< Menu input
 
 UImenuItem *graphMenuItems[] =
     {&graphSeparator0, &opt_gr_type,
      &graphSeparator1, &gr_yscale_full_range,
      &opt_gr_yscale,   &gr_yscale_show0,
      &graphSeparator2, &gr_xscale_autosample,
-     &gr_sample_time,  &closeMenu,
+     &gr_sample_time,  &gr_xscale_average,
+     &opt_gr_span,     &closeMenu,
      &exitMenu}; ///< Collects all items in the graph menu
 
 /*!
@@ -726,6 +984,7 @@ void UImanager::setupMenus() {
   gr_yscale_full_range.setValue(true);
   gr_yscale_full_range.change();
   gr_xscale_autosample.setValue(k197dev.getAutosample());
+  gr_xscale_average.setValue(k197dev.isGraphAveraging());
 
   permadata::retrieve_from_EEPROM(true);
 }
@@ -818,7 +1077,7 @@ void UImanager::logData() {
   }
   logskip_counter = 0;
   if (logTimestamp.getValue()) {
-    Serial.print(millis());
+    Serial.print(k197dev.getFrameTimestamp());
     logU2U();
     Serial.print(F(" ms; "));
   }
@@ -850,6 +1109,16 @@ void UImanager::logData() {
     Serial.print(formatNumber(buf, k197dev.getMax()));
     logU2U();
     Serial.print(unit);
+    Serial.print(F("; "));
+    Serial.print(formatNumber(buf, k197dev.getMean()));
+    logU2U();
+    Serial.print(unit);
+    Serial.print(F("; "));
+    Serial.print(formatNumber(buf, k197dev.getStdDev()));
+    logU2U();
+    Serial.print(unit);
+    Serial.print(F("; "));
+    Serial.print(k197dev.getCount());
   }
   Serial.println();
   CHECK_FREE_STACK();
@@ -981,8 +1250,6 @@ static void printXYLabel(k197graph_label_type l, uint16_t nseconds, bool hold) {
     @param marker_type market type
 */
 void UImanager::drawMarker(u8g2_uint_t x, u8g2_uint_t y, char marker_type) {
-  static const u8g2_uint_t marker_size = 7;
-  // k197_display_graph_type::x_size
   u8g2_uint_t x0 = x < marker_size ? 0 : x - marker_size;
   u8g2_uint_t x1 = k197_display_graph_type::x_size < (x + marker_size)
                        ? k197_display_graph_type::x_size
@@ -991,15 +1258,21 @@ void UImanager::drawMarker(u8g2_uint_t x, u8g2_uint_t y, char marker_type) {
   u8g2_uint_t y1 = k197_display_graph_type::y_size < (y + marker_size)
                        ? k197_display_graph_type::y_size
                        : y + marker_size;
+  u8g2_uint_t h = u8g2.getMaxCharHeight();
+  bool above = int(y1) > (k197_display_graph_type::y_size - h);
+  u8g2_uint_t w = 2 * marker_size + 1;
+  if (x0 + w > k197_display_graph_type::x_size)
+    w = k197_display_graph_type::x_size - x0;
+  if (!saveOverlayArea(x0, above ? y0 - h : y0, w, y1 - y0 + 1 + h))
+    graph_area_valid = false; // the marker would scroll with the graph
   switch (marker_type) {
   case UImanager::CURSOR_A:
     u8g2.drawLine(x0, y0, x, y);
     u8g2.drawLine(x, y, x1, y1);
     u8g2.drawLine(x0, y1, x, y);
     u8g2.drawLine(x, y, x1, y0);
-    if (int(y1) > (k197_display_graph_type::y_size - u8g2.getMaxCharHeight())) {
-      u8g2.setCursor(x0,
-                     y0 - u8g2.getMaxCharHeight()); // Position above the marker
+    if (above) {
+      u8g2.setCursor(x0, y0 - h); // Position above the marker
     } else {
       u8g2.setCursor(x0, y1); // Position below the marker
     }
@@ -1012,18 +1285,63 @@ void UImanager::drawMarker(u8g2_uint_t x, u8g2_uint_t y, char marker_type) {
     u8g2.drawLine(x, y0, x, y1);
     u8g2.drawFrame(x0, y0, x1 - x0, y1 - y0);
     bool actv = getActiveCursor() == marker_type;
-    if (int(y1) > (k197_display_graph_type::y_size - u8g2.getMaxCharHeight())) {
-      u8g2.setCursor(x1 - u8g2.getMaxCharWidth() * (actv ? 2 : 1),
-                     y0 - u8g2.getMaxCharHeight()); // Position above the marker
+    u8g2_uint_t xlabel = x1 - u8g2.getMaxCharWidth() * (actv ? 2 : 1);
+    if (above) {
+      u8g2.setCursor(xlabel, y0 - h); // Position above the marker
     } else {
-      u8g2.setCursor(x1 - u8g2.getMaxCharWidth(),
-                     y1); // Position below the marker
+      u8g2.setCursor(xlabel, y1); // Position below the marker
     }
     if (actv)
       u8g2.print('>');
     u8g2.print(marker_type);
     break;
   }
+  u8g2.setMaxClipWindow();
+}
+
+/*!
+    @brief save an area of the graph before drawing over the graph
+    @details the zero axis and the cursor markers are drawn over the graph
+   after it has been scrolled and updated, in areas saved by this function.
+   eraseOverlay() restores the areas before the next scroll, so that the
+   graph area holds only the graph. Drawing is limited to the area until
+   u8g2.setMaxClipWindow() is called
+    @param x Coordinate x of the first column
+    @param y Coordinate y of the first line
+    @param w width (the area must be within the graph area)
+    @param h height
+    @return false if the area could not be saved: the caller must set
+   graph_area_valid to false
+*/
+bool UImanager::saveOverlayArea(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w,
+                                u8g2_uint_t h) {
+  if (overlay_nareas >= max_overlay_areas ||
+      overlay_nbits + w * h > overlay_bits_size * 8)
+    return false;
+  overlay_area_type &a = overlay_area[overlay_nareas++];
+  a.x = x;
+  a.y = y;
+  a.w = w;
+  a.h = h;
+  copyBufferBits(x, y, w, h, overlay_bits, overlay_nbits, false);
+  overlay_nbits += w * h;
+  u8g2.setClipWindow(x, y, x + w, y + h);
+  return true;
+}
+
+/*!
+    @brief restore the areas saved by saveOverlayArea()
+    @details the areas are restored in reverse order, as they can overlap.
+   Nothing is restored if graph_area_valid is false: the graph area will be
+   drawn again anyway
+*/
+void UImanager::eraseOverlay() {
+  while (overlay_nareas > 0) {
+    const overlay_area_type &a = overlay_area[--overlay_nareas];
+    overlay_nbits -= a.w * a.h;
+    if (graph_area_valid)
+      copyBufferBits(a.x, a.y, a.w, a.h, overlay_bits, overlay_nbits, true);
+  }
 }
 
 /*!
@@ -1032,9 +1350,14 @@ void UImanager::drawMarker(u8g2_uint_t x, u8g2_uint_t y, char marker_type) {
 */
 void UImanager::updateGraphScreen() {
   bool hold = k197dev.getDisplayHold();
+  eraseOverlay();
 
   // Get graph data
-  k197dev.fillGraphDisplayData(&k197graph, opt_gr_yscale.getValue(), hold);
+  PROFILE_start(DebugOut.PROFILE_GRAPH);
+  k197dev.fillGraphDisplayData(
+      &k197graph, opt_gr_yscale.getValue(), hold, opt_gr_span.getValue(),
+      opt_gr_type.getValue() == OPT_GRAPH_TYPE_ENVELOPE);
+  PROFILE_stop(DebugOut.PROFILE_GRAPH);
   RT_ASSERT(k197graph.gr_size <= k197graph.x_size, "!updGrDsp1");
 
   // autoscale x axis
@@ -1047,15 +1370,32 @@ void UImanager::updateGraphScreen() {
   byte xscale = k197graph.x_size / i1;
   RT_ASSERT(k197graph.gr_size <= k197graph.x_size, "!updGrDsp1");
 
+  // Graph area: if possible the graph of the previous frame is scrolled, and
+  // only the points from first on are drawn (see fillGraphDisplayData())
+  byte gr_type = opt_gr_type.getValue();
+  int first = k197graph.first_changed;
+  if (graph_area_valid && first > 0 && xscale == graph_area_xscale &&
+      gr_type == graph_area_type) {
+    scrollBufferColumns(0, k197graph.x_size, k197graph.num_removed * xscale,
+                        first * xscale);
+    if (k197graph.num_removed > 0 && !k197graph.envelope &&
+        gr_type != OPT_GRAPH_TYPE_DOTS) { // column 0 still has the end of the
+      scrollBufferColumns(0, 1, 0, 0);    // line that scrolled out
+      u8g2.drawLine(0, k197graph.y_size - k197graph.point[0], xscale,
+                    k197graph.y_size - k197graph.point[1]);
+    }
+  } else {
+    if (graph_area_valid) // otherwise it was cleared by updateDisplay()
+      scrollBufferColumns(0, k197graph.x_size, 0, 0);
+    first = 0;
+  }
+  graph_area_xscale = xscale;
+  graph_area_type = gr_type;
+  graph_area_valid = true;
+
   // Y axis
   u8g2.drawLine(k197graph.x_size, k197graph.y_size, k197graph.x_size, 0);
 
-  // X axis
-  if (gr_yscale_show0.getValue() && k197graph.y0.isNegative() &&
-      k197graph.y1.isPositive()) {
-    drawDottedHLine(0, k197graph.y_size - k197graph.y_zero,
-                    k197graph.x_size); // zero axis
-  }
   u8g2.setFont(u8g2_font_6x12_mr);
 
   // Draw axis labels
@@ -1063,23 +1403,29 @@ void UImanager::updateGraphScreen() {
   u8g2.setCursor(k197graph.x_size + 2,
                  k197graph.y_size - u8g2.getMaxCharHeight());
   printXYLabel(k197graph.y0,
-               k197graph.nsamples_graph == 0
-                   ? 60 / xscale
-                   : (60 / xscale) * k197graph.nsamples_graph,
+               (k197graph.x_size / xscale) * k197graph.sample_period + 0.5,
                hold);
   u8g2.setCursor(k197graph.x_size + 2, 0);
   printYLabel(k197graph.y1, hold);
   u8g2_uint_t topln_x = u8g2.tx;
 
   // Draw the graph
-  if ((opt_gr_type.getValue() == OPT_GRAPH_TYPE_DOTS) ||
+  if (k197graph.envelope) { // a vertical bar from min to max
+    for (int i = first; i < k197graph.gr_size; i++) {
+      RT_ASSERT(k197graph.point[i] <= k197graph.y_size, "!updGrDsp2d");
+      RT_ASSERT(k197graph.point_low[i] <= k197graph.point[i], "!updGrDsp2e");
+      u8g2.drawVLine(i * xscale, k197graph.y_size - k197graph.point[i],
+                     k197graph.point[i] - k197graph.point_low[i] + 1);
+    }
+  } else if ((opt_gr_type.getValue() == OPT_GRAPH_TYPE_DOTS) ||
       (k197graph.gr_size < 2)) {
-    for (int i = 0; i < k197graph.gr_size; i++) {
+    for (int i = first; i < k197graph.gr_size; i++) {
       RT_ASSERT(k197graph.point[i] <= k197graph.y_size, "!updGrDsp2a");
       u8g2.drawPixel(i * xscale, k197graph.y_size - k197graph.point[i]);
     }
   } else { // OPT_GRAPH_TYPE_LINES && k197graph.gr_size>=2
-    for (int i = 0; i < (k197graph.gr_size - 1); i++) {
+    for (int i = first > 0 ? first - 1 : 0; i < (k197graph.gr_size - 1);
+         i++) {
       RT_ASSERT(k197graph.point[i] <= k197graph.y_size, "!updGrDsp2b");
       RT_ASSERT(k197graph.point[i + 1] <= k197graph.y_size, "!updGrDsp2c");
       u8g2.drawLine(i * xscale, k197graph.y_size - k197graph.point[i],
@@ -1088,8 +1434,18 @@ void UImanager::updateGraphScreen() {
     }
   }
 
+  // X axis, drawn over the graph (see saveOverlayArea())
+  if (gr_yscale_show0.getValue() && k197graph.y0.isNegative() &&
+      k197graph.y1.isPositive()) {
+    u8g2_uint_t y = k197graph.y_size - k197graph.y_zero;
+    if (!saveOverlayArea(0, y, k197graph.x_size, 1))
+      graph_area_valid = false; // the dots would not scroll correctly
+    drawDottedHLine(0, y, k197graph.x_size); // zero axis
+    u8g2.setMaxClipWindow();
+  }
+
   // Information panel
-  if (areCursorsVisible() && k197graph.gr_size > 0) {
+  if (areCursorsVisible() && k197graph.level == 0 && k197graph.gr_size > 0) {
     u8g2_uint_t ax =
         cursor_a >= k197graph.gr_size ? k197graph.gr_size - 1 : cursor_a;
     u8g2_uint_t bx =
@@ -1200,13 +1556,13 @@ void UImanager::drawGraphScreenCursorPanel(u8g2_uint_t topln_x, u8g2_uint_t ax,
   if (k197dev.isREL(hold))
     u8g2.print(F("REL"));
 
-  u8g2.setCursor(183, u8g2.ty + u8g2.getMaxCharHeight() + 4);
+  u8g2.setCursor(183, u8g2.ty + u8g2.getMaxCharHeight() + 3);
   u8g2.print(F("<A>"));
   u8g2.print(CH_SPACE);
   // u8g2.print(k197dev.getGraphValue(ax, hold), 6);
   u8g2.print(formatNumber(buf, k197dev.getGraphValue(ax, hold)));
 
-  u8g2.setCursor(183, u8g2.ty + u8g2.getMaxCharHeight() + 2);
+  u8g2.setCursor(183, u8g2.ty + u8g2.getMaxCharHeight() + 1);
   u8g2.print(F("<B>"));
   u8g2.print(CH_SPACE);
   // u8g2.print(k197dev.getGraphValue(bx, hold), 6);
@@ -1214,7 +1570,7 @@ void UImanager::drawGraphScreenCursorPanel(u8g2_uint_t topln_x, u8g2_uint_t ax,
 
   uint16_t deltax = ax > bx ? ax - bx : bx - ax;
 
-  u8g2.setCursor(183, u8g2.ty + u8g2.getMaxCharHeight() + 2);
+  u8g2.setCursor(183, u8g2.ty + u8g2.getMaxCharHeight() + 1);
   u8g2.print(F("Avg"));
   u8g2.print(CH_SPACE);
   // u8g2.print(k197dev.getGraphAverage(ax < bx ? ax : bx, deltax+1),
@@ -1222,14 +1578,22 @@ void UImanager::drawGraphScreenCursorPanel(u8g2_uint_t topln_x, u8g2_uint_t ax,
   u8g2.print(formatNumber(
       buf, k197dev.getGraphAverage(ax < bx ? ax : bx, deltax + 1, hold)));
 
-  u8g2.setCursor(183, u8g2.ty + u8g2.getMaxCharHeight() + 2);
+  u8g2.setCursor(183, u8g2.ty + u8g2.getMaxCharHeight() + 1);
+  u8g2.print(F("RMS"));
+  u8g2.print(CH_SPACE);
+  u8g2.print(formatNumber(
+      buf, k197dev.getGraphRMS(ax < bx ? ax : bx, deltax + 1, hold)));
+
+  u8g2.setCursor(183, u8g2.ty + u8g2.getMaxCharHeight() + 1);
+  u8g2.print(F("SD"));
+  u8g2.print(CH_SPACE);
+  u8g2.print(formatNumber(
+      buf, k197dev.getGraphStdDev(ax < bx ? ax : bx, deltax + 1, hold)));
+
+  u8g2.setCursor(183, u8g2.ty + u8g2.getMaxCharHeight() + 1);
   u8g2.print(F("Dt"));
   u8g2.print(CH_SPACE);
-  if (k197graph.nsamples_graph == 0) {
-    u8g2.print(float(deltax) / 3.0, 2);
-  } else {
-    u8g2.print(deltax * k197graph.nsamples_graph / 3.0);
-  }
+  u8g2.print(deltax * k197graph.sample_period, 2);
   u8g2.print(CH_SPACE);
   u8g2.print('s');
 
@@ -1414,12 +1778,14 @@ void permadata::copyFromUI() {
   bool_options.logError = logError.getValue();
   bool_options.unused_no_2 = false;
   bool_options.gr_yscale_full_range = gr_yscale_full_range.getValue();
+  bool_options.gr_xscale_average = gr_xscale_average.getValue();
   byte_options.contrastCtrl = contrastCtrl.getValue();
   byte_options.logSkip = logSkip.getValue();
   byte_options.logStatSamples = logStatSamples.getValue();
   byte_options.opt_gr_type = opt_gr_type.getValue();
   byte_options.opt_gr_yscale = (byte)opt_gr_yscale.getValue();
   byte_options.gr_sample_time = gr_sample_time.getValue();
+  byte_options.opt_gr_span = opt_gr_span.getValue();
   screenMode = uiman.getScreenMode();
   byte_options.cursor_a = uiman.getCursorPosition(UImanager::CURSOR_A);
   byte_options.cursor_b = uiman.getCursorPosition(UImanager::CURSOR_B);
@@ -1455,9 +1821,12 @@ void permadata::copyToUI(bool restore_screen_mode) {
   gr_xscale_autosample.change();
   gr_yscale_full_range.setValue(bool_options.gr_yscale_full_range);
   gr_yscale_full_range.change();
+  gr_xscale_average.setValue(bool_options.gr_xscale_average);
+  gr_xscale_average.change();
 
   uiman.setContrast(byte_options.contrastCtrl);
   opt_gr_type.setValue(byte_options.opt_gr_type);
+  opt_gr_span.setValue(byte_options.opt_gr_span);
   if (!bool_options.gr_xscale_autosample) { // Do not mess sample rate if
                                             // autosamplig mode
     gr_sample_time.setValue(byte_options.gr_sample_time);
@@ -85,6 +85,58 @@ private:
 
   bool hold_flag = false; ///< prevents changing hold mode at long press
 
+  bool graph_area_valid = false; ///< true if the graph area of the buffer
+                                 ///< still holds the graph of the last frame
+  byte graph_area_xscale = 0;    ///< xscale of the graph in the graph area
+  byte graph_area_type = 0;      ///< graph type of the graph in the graph area
+
+  static const u8g2_uint_t marker_size =
+      7; ///< half size of the cursor markers, see drawMarker()
+  static const byte max_overlay_areas =
+      3; ///< areas drawn over the graph: zero axis and two cursor markers
+  static const uint16_t overlay_bits_size =
+      (k197_display_graph_type::x_size +
+       2 * (2 * marker_size + 1) * (2 * marker_size + 1 + 12) + 7) /
+      8; ///< bytes to save the areas, 12 is the height of the marker labels
+  /*!
+     @brief  an area of the graph area drawn over the graph, see
+     saveOverlayArea()
+  */
+  struct overlay_area_type {
+    byte x; ///< first column
+    byte y; ///< first line
+    byte w; ///< width
+    byte h; ///< height
+  };
+  overlay_area_type overlay_area[max_overlay_areas]; ///< areas in use
+  byte overlay_nareas = 0;              ///< number of areas in use
+  uint16_t overlay_nbits = 0;           ///< bits of overlay_bits in use
+  byte overlay_bits[overlay_bits_size]; ///< the pixels under the areas
+  bool saveOverlayArea(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w,
+                       u8g2_uint_t h);
+  void eraseOverlay();
+
+  static const byte tile_group_size =
+      4; ///< number of 8x8 tiles sharing a checksum, see markDirtyTiles()
+  static const byte tile_rows =
+      display_size_y / 8; ///< number of rows of tiles in the display
+  static const byte tile_groups =
+      display_size_x / 8 / tile_group_size; ///< number of groups in a row
+  static const byte bytes_per_tile =
+      32; ///< bytes sent for each tile (the SSD1322 has 4 bits per pixel)
+  uint16_t tile_checksum[tile_rows][tile_groups]; ///< last data queued
+  bool tile_checksum_valid = false; ///< if false all tiles are sent
+  byte tile_dirty[tile_rows] = {0}; ///< groups still to send (1 bit each)
+  byte refresh_row = 0;             ///< row of tiles sent in any case
+  byte xfer_row = tile_rows;        ///< next row of tiles to send
+  uint16_t xfer_bytes = 0;          ///< bytes sent in the last update
+  unsigned long xfer_time = 0UL;    ///< time spent in the last update (us)
+  unsigned long xfer_time_max = 0UL; ///< max time in a single pollDisplay()
+  unsigned long render_time = 0UL;   ///< time spent drawing the last update
+  unsigned long render_time_max = 0UL; ///< max render_time since last reset
+  void markDirtyTiles();
+  void discardDirtyTiles();
+
   K197screenMode screen_mode =
       (K197screenMode)(K197sc_normal |
                        K197sc_FullScreenBitMask); ///< Keep track of how to
@@ -277,6 +329,59 @@ public:
   void updateDisplay(bool stepDoodle = true);
   void updateBtStatus();
 
+  bool pollDisplay();
+  void flushDisplay();
+  /*!
+     @brief  check if the last update has been completely sent to the display
+     @return true if there is nothing left to send (see pollDisplay())
+  */
+  bool isDisplayIdle() { return xfer_row >= tile_rows; };
+  /*!
+     @brief  get the amount of data sent to the display in the last update
+     @return the number of bytes (see markDirtyTiles())
+  */
+  uint16_t getTransferBytes() { return xfer_bytes; };
+  /*!
+     @brief  get the time spent sending data to the display in the last update
+     @details this is the sum of the time spent in all the pollDisplay() calls
+     needed to send the update
+     @return the time in microseconds
+  */
+  unsigned long getTransferTime() { return xfer_time; };
+  /*!
+     @brief  get the maximum time spent in a single call to pollDisplay()
+     @details this is the longest time loop() was blocked by the display
+     transfer. The maximum is calculated since the last call with reset = true
+     @param reset if true the maximum is reset after reading it
+     @return the time in microseconds
+  */
+  unsigned long getTransferTimeMax(bool reset = false) {
+    unsigned long t = xfer_time_max;
+    if (reset)
+      xfer_time_max = 0UL;
+    return t;
+  };
+
+  /*!
+     @brief  get the time spent drawing the last update in the buffer
+     @details this does not include sending the buffer to the display
+     @return the time in microseconds
+  */
+  unsigned long getRenderTime() { return render_time; };
+  /*!
+     @brief  get the maximum time spent drawing an update in the buffer
+     @details the maximum is calculated since the last call with reset = true
+     @param reset if true the maximum is reset after reading it
+     @return the time in microseconds
+  */
+  unsigned long getRenderTimeMax(bool reset = false) {
+    unsigned long t = render_time_max;
+    if (reset)
+      render_time_max = 0UL;
+    return t;
+  };
+  void printScreen(Print &out);
+
   void setContrast(uint8_t value);
 
   bool handleUIEvent(K197UIeventsource eventSource, K197UIeventType eventType);
@@ -301,7 +406,7 @@ private:
       0x1a2b3c4dul; ///< This is the magic number telling us if the EEPROM
                     ///< contains data
   static const unsigned long revisionExpected =
-      0x02ul; ///< the revision of this structure. Increment whenever the
+      0x03ul; ///< the revision of this structure. Increment whenever the
               ///< structure is modified
 
   // structure identity
@@ -335,6 +440,7 @@ private:
         bool logError : 1;             ///< store menu option value
         bool unused_no_2 : 1;          ///< backward compatibility
         bool gr_yscale_full_range : 1; ///< store menu option value
+        bool gr_xscale_average : 1;    ///< store menu option value
       };
     } __attribute__((packed)); ///<
   }; ///< Structure designed to pack a number of flags into two bytes
@@ -348,6 +454,7 @@ private:
     byte gr_sample_time; ///< store menu option value
     byte cursor_a;       ///< store cursor A position
     byte cursor_b;       ///< store cursor B position
+    byte opt_gr_span;    ///< store menu option value
   }; ///< Structure designed to collect all byte optipons together
 
   bool_options_struct bool_options; ///< store all bool options
@@ -126,3 +126,84 @@ void debugUtil::flush() {
     u8g2log.flush();
   }
 }
+
+#ifdef PROFILE_TIMER
+// Names of the profiled sections, in the same order as the PROFILE_xxx
+// constants. The indentation shows how the sections are nested
+static const char prof_name_loop[] PROGMEM = "loop";
+static const char prof_name_device[] PROGMEM = " getNewReading";
+static const char prof_name_decode[] PROGMEM = "  decode";
+static const char prof_name_cache[] PROGMEM = "  updateCache";
+static const char prof_name_display[] PROGMEM = " updateDisplay";
+static const char prof_name_graph[] PROGMEM = "  fillGraphData";
+static const char prof_name_send[] PROGMEM = " pollDisplay";
+static const char prof_name_log[] PROGMEM = " logData";
+static const char prof_name_bt[] PROGMEM = " BT checks";
+static const char prof_name_resample[] PROGMEM = " resampleGraph";
+static const char *const
+    prof_names[debugUtil::PROFILE_SECTIONS] PROGMEM = {
+        prof_name_loop,  prof_name_device, prof_name_decode,
+        prof_name_cache, prof_name_display, prof_name_graph,
+        prof_name_send,  prof_name_log,     prof_name_bt,
+        prof_name_resample}; ///< names of the profiled sections
+
+/*!
+        @brief  stop profiling a section of code
+        @details the time elapsed since profileStart() is added to the
+   statistics of the section. Nothing is printed, see profileSummary()
+        @param section the section (one of the PROFILE_xxx constants)
+*/
+void debugUtil::profileStop(byte section) {
+  if (section >= PROFILE_SECTIONS)
+    return;
+  profile_section_type *p = &profsection[section];
+  unsigned long dt = micros() - p->start;
+  if (p->count == 0 || dt < p->tmin)
+    p->tmin = dt;
+  if (dt > p->tmax)
+    p->tmax = dt;
+  p->total += dt;
+  p->count++;
+}
+
+/*!
+        @brief  reset the statistics of all the profiled sections
+*/
+void debugUtil::profileReset() {
+  for (byte i = 0; i < PROFILE_SECTIONS; i++) {
+    profsection[i].count = 0UL;
+    profsection[i].total = 0UL;
+    profsection[i].tmin = 0UL;
+    profsection[i].tmax = 0UL;
+  }
+}
+
+/*!
+        @brief  print the statistics of all the profiled sections and reset
+   them
+        @details for each section the number of executions and the average,
+   minimum, maximum and total time in microseconds are printed. Sections that
+   have not been executed are skipped
+        @param out the stream to print to (normally Serial)
+*/
+void debugUtil::profileSummary(Print &out) {
+  out.println(F("section: n avg min max total (us)"));
+  for (byte i = 0; i < PROFILE_SECTIONS; i++) {
+    const profile_section_type *p = &profsection[i];
+    if (p->count == 0)
+      continue;
+    out.print((const __FlashStringHelper *)pgm_read_ptr(&prof_names[i]));
+    out.print(F(": "));
+    out.print(p->count);
+    out.print(' ');
+    out.print(p->total / p->count);
+    out.print(' ');
+    out.print(p->tmin);
+    out.print(' ');
+    out.print(p->tmax);
+    out.print(' ');
+    out.println(p->total);
+  }
+  profileReset();
+}
+#endif // PROFILE_TIMER
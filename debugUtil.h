@@ -42,10 +42,14 @@
 /**************************************************************************/
 
 //#define PROFILE_TIMER 1 ///< when defined, add the possibility to profile
-// sections of code
+// sections of code (see PROFILE_start() and the "prof" serial command)
 
 //#define RUNTIME_ASSERTS 1 ///< when defined, add additional runtime checks
 
+//#define SELF_TEST 1 ///< when defined, add the "test" serial command (see
+// K197device::selfTest()). Uses 180 bytes of RAM, clears the graph and the
+// statistics
+
 /**************************************************************************/
 /*!
    @brief class implementing an object used as debug output
@@ -65,14 +69,35 @@ class debugUtil : public Print {
   bool use_oled = false;   ///< enable Oled output if true
 
 #ifdef PROFILE_TIMER
-  unsigned long proftimer[PROFILE_TIMER]; ///< store the profile timers(s)
-
 public:
-  static const byte PROFILE_MATH = 0;    ///< profiler time slot for math stuff
-  static const byte PROFILE_LOOP = 1;    ///< profiler time slot for loop()
-  static const byte PROFILE_DEVICE = 2;  ///< profiler time slot for K197dev
-  static const byte PROFILE_DISPLAY = 3; ///< profiler time slot for uiman
-#endif                                   // PROFILE_TIMER
+  // Profiled sections. The names are in debugUtil.cpp, indented to show how
+  // the sections are nested
+  static const byte PROFILE_LOOP = 0;     ///< profiler section for loop()
+  static const byte PROFILE_DEVICE = 1;   ///< section for getNewReading()
+  static const byte PROFILE_DECODE = 2;   ///< section for the decoding
+  static const byte PROFILE_CACHE = 3;    ///< section for the statistics
+  static const byte PROFILE_DISPLAY = 4;  ///< section for updateDisplay()
+  static const byte PROFILE_GRAPH = 5;    ///< section for the graph data
+  static const byte PROFILE_SEND = 6;     ///< section for pollDisplay()
+  static const byte PROFILE_LOG = 7;      ///< section for logData()
+  static const byte PROFILE_BT = 8;       ///< section for the BT checks
+  static const byte PROFILE_RESAMPLE = 9; ///< section for resampleGraph()
+  static const byte PROFILE_SECTIONS = 10; ///< number of profiled sections
+
+private:
+  /*!
+    @brief  accumulated execution time of a profiled section
+  */
+  struct profile_section_type {
+    unsigned long start; ///< micros() when the section was entered
+    unsigned long count; ///< number of times the section was executed
+    unsigned long total; ///< total time spent in the section (us)
+    unsigned long tmin;  ///< shortest execution time (us)
+    unsigned long tmax;  ///< longest execution time (us)
+  };
+  profile_section_type
+      profsection[PROFILE_SECTIONS]; ///< statistics for each section
+#endif // PROFILE_TIMER
 
 public:
   /*!
@@ -136,44 +161,19 @@ public:
 
 #ifdef PROFILE_TIMER
   /*!
-    @brief  start a profile timer
-    @details a profile timer is used to measure the execution time of a given
-    section of code bracketed between profileStart() and profileEnd();
-    @param slot the slot number of this particular timer
-  */
-  void profileStart(unsigned int slot) {
-    if (slot < PROFILE_TIMER)
-      proftimer[slot] = micros();
-  }
-  /*!
-    @brief  Stop a profile timer
-    @param slot the slot number of this particular timer
+    @brief  start profiling a section of code
+    @details the execution time of the code between profileStart() and
+    profileStop() is added to the statistics of the section. Different
+    sections can be nested, but a section cannot be nested in itself
+    @param section the section (one of the PROFILE_xxx constants)
   */
-  void profileStop(unsigned int slot) {
-    if (slot < PROFILE_TIMER)
-      proftimer[slot] = micros() - proftimer[slot];
-  }
-  /*!
-    @brief  print a profile timer
-    @param slot the slot number of this particular timer
-  */
-  void profilePrint(unsigned int slot) {
-    if (slot < PROFILE_TIMER)
-      print(proftimer[slot]);
-  }
-  /*!
-    @brief  print a profile timer
-    @param slot the slot number of this particular timer
-    @param slotName the name of the slot
-  */
-  void profilePrintln(unsigned int slot, const __FlashStringHelper *slotName) {
-    if (slot < PROFILE_TIMER) {
-      print(slotName);
-      print('=');
-      print(proftimer[slot]);
-      println(F("us"));
-    }
+  void profileStart(byte section) {
+    if (section < PROFILE_SECTIONS)
+      profsection[section].start = micros();
   }
+  void profileStop(byte section);
+  void profileReset();
+  void profileSummary(Print &out);
 #endif // PROFILE_TIMER
 };
 
@@ -182,19 +182,42 @@ extern debugUtil
               ///< etc. (similar to how Serial is used for debug output)
 
 #ifdef PROFILE_TIMER
+/**************************************************************************/
+/*!
+   @brief profile the rest of the enclosing block
+
+   @details profileStart() is called by the constructor and profileStop() by
+   the destructor, so that every return path is accounted for. Normally used
+   via PROFILE_scope()
+*/
+/**************************************************************************/
+class profileScope {
+  byte section; ///< the profiled section
+public:
+  /*!
+     @brief  constructor, start profiling
+     @param s the section (one of the debugUtil::PROFILE_xxx constants)
+  */
+  profileScope(byte s) : section(s) { DebugOut.profileStart(section); };
+  /*!
+     @brief  destructor, stop profiling
+  */
+  ~profileScope() { DebugOut.profileStop(section); };
+};
+
 #define PROFILE_start(...)                                                     \
   DebugOut.profileStart(__VA_ARGS__) ///< macro to start profiling
 #define PROFILE_stop(...)                                                      \
   DebugOut.profileStop(__VA_ARGS__) ///< macro to stop profiling
-#define PROFILE_print(...)                                                     \
-  DebugOut.profilePrint(__VA_ARGS__) ///< macro to print the counter
-#define PROFILE_println(...)                                                   \
-  DebugOut.profilePrintln(__VA_ARGS__) ///< macro to print the counter
+#define PROFILE_scope(section)                                                 \
+  profileScope profile_scope(section) ///< profile the rest of the block
+#define PROFILE_summary(...)                                                   \
+  DebugOut.profileSummary(__VA_ARGS__) ///< macro to print the statistics
 #else
 #define PROFILE_start(...)   ///< Does nothing when not profiling
 #define PROFILE_stop(...)    ///< Does nothing when not profiling
-#define PROFILE_print(...)   ///< Does nothing when not profiling
-#define PROFILE_println(...) ///< Does nothing when not profiling
+#define PROFILE_scope(...)   ///< Does nothing when not profiling
+#define PROFILE_summary(...) ///< Does nothing when not profiling
 #endif                       // PROFILE_TIMER
 
 #ifdef RUNTIME_ASSERTS
@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+"""Compare the screen dumped by the "scr" serial command with a reference.
+
+Arduino K197Display sketch, Copyright (C) 2022 by ALX2009, License: MIT (see
+LICENSE). This file is part of the Arduino K197Display sketch, please see
+https://github.com/alx2009/K197Display for more information
+
+The "scr" command prints the display buffer as a plain PBM image (P1). This
+script gets the image either directly from the serial port (sending "scr",
+requires pyserial) or from a file/stdin (e.g. a terminal log), then compares
+it pixel by pixel with a reference PBM.
+
+Pixels that change between captures (e.g. the measured value) can be masked:
+if <reference>.mask.pbm exists, the pixels set in the mask are ignored.
+
+Examples:
+  # record a reference with the board showing the screen to check
+  screen_compare.py --port /dev/ttyUSB0 --record screens/menu.pbm
+  # compare (exit status 1 if different), optionally saving the differences
+  screen_compare.py --port /dev/ttyUSB0 screens/menu.pbm --diff diff.pbm
+  # compare a terminal log that includes the "scr" output
+  screen_compare.py --input terminal.log screens/menu.pbm
+"""
+
+import argparse
+import os
+import sys
+
+
+def parse_pbm(text):
+    """Parse the first plain PBM image in text.
+
+    Anything before the "P1" magic (e.g. the echoed command or debug output)
+    is ignored, as well as comments. Returns (width, height, pixels), where
+    pixels is a list of rows of 0/1 values.
+    """
+    lines = text.splitlines()
+    start = next((i for i, l in enumerate(lines) if l.strip() == "P1"), None)
+    if start is None:
+        raise ValueError("no P1 image found")
+    tokens = []
+    for line in lines[start + 1:]:
+        tokens.extend(line.split("#", 1)[0].split())
+    if len(tokens) < 2:
+        raise ValueError("truncated PBM header")
+    width, height = int(tokens[0]), int(tokens[1])
+    bits = "".join(tokens[2:])
+    if len(bits) < width * height:
+        raise ValueError("truncated image: %d of %d pixels"
+                         % (len(bits), width * height))
+    bits = bits[:width * height]
+    if set(bits) - {"0", "1"}:
+        raise ValueError("invalid pixel value")
+    pixels = [[int(c) for c in bits[y * width:(y + 1) * width]]
+              for y in range(height)]
+    return width, height, pixels
+
+
+def format_pbm(width, height, pixels):
+    """Format an image as plain PBM, 64 pixels per line like "scr"."""
+    out = ["P1", "%d %d" % (width, height)]
+    for row in pixels:
+        for x in range(0, width, 64):
+            out.append("".join(str(p) for p in row[x:x + 64]))
+    return "\n".join(out) + "\n"
+
+
+def read_pbm_file(path):
+    with open(path) as f:
+        return parse_pbm(f.read())
+
+
+def capture_serial(port, baud, timeout):
+    """Send "scr" and return the text received until the image is complete."""
+    try:
+        import serial  # pyserial
+    except ImportError:
+        sys.exit("pyserial is required for --port (pip install pyserial)")
+    with serial.Serial(port, baud, timeout=timeout) as ser:
+        ser.reset_input_buffer()
+        ser.write(b"scr\n")
+        text = ""
+        while True:
+            chunk = ser.read(4096).decode("ascii", "replace")
+            if not chunk:  # timeout
+                break
+            text += chunk
+            try:
+                parse_pbm(text)
+                break
+            except ValueError:
+                pass
+    return text
+
+
+def compare(image, reference, mask=None):
+    """Return (number of different pixels, diff image, bounding box)."""
+    w, h, pix = image
+    rw, rh, ref = reference
+    if (w, h) != (rw, rh):
+        raise ValueError("size %dx%d, reference %dx%d" % (w, h, rw, rh))
+    if mask is not None and (mask[0], mask[1]) != (w, h):
+        raise ValueError("the mask has a different size")
+    diff = [[0] * w for _ in range(h)]
+    count = 0
+    box = None
+    for y in range(h):
+        for x in range(w):
+            if mask is not None and mask[2][y][x]:
+                continue
+            if pix[y][x] != ref[y][x]:
+                diff[y][x] = 1
+                count += 1
+                if box is None:
+                    box = [x, y, x, y]
+                else:
+                    box = [min(box[0], x), min(box[1], y),
+                           max(box[2], x), max(box[3], y)]
+    return count, diff, box
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='compare the "scr" output with a reference PBM')
+    parser.add_argument("reference", help="reference PBM file")
+    src = parser.add_mutually_exclusive_group(required=True)
+    src.add_argument("--port", help='serial port, "scr" is sent to the board')
+    src.add_argument("--input", help='file with the "scr" output, - for stdin')
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--timeout", type=float, default=5.0,
+                        help="serial timeout (s)")
+    parser.add_argument("--record", action="store_true",
+                        help="save the image as the reference, no compare")
+    parser.add_argument("--diff", help="save the different pixels as PBM")
+    args = parser.parse_args()
+
+    if args.port:
+        text = capture_serial(args.port, args.baud, args.timeout)
+    elif args.input == "-":
+        text = sys.stdin.read()
+    else:
+        with open(args.input) as f:
+            text = f.read()
+    try:
+        image = parse_pbm(text)
+    except ValueError as e:
+        sys.exit("capture: %s" % e)
+
+    if args.record:
+        with open(args.reference, "w") as f:
+            f.write(format_pbm(*image))
+        print("recorded %s (%dx%d)" % (args.reference, image[0], image[1]))
+        return 0
+
+    try:
+        reference = read_pbm_file(args.reference)
+        mask_path = os.path.splitext(args.reference)[0] + ".mask.pbm"
+        mask = read_pbm_file(mask_path) if os.path.exists(mask_path) else None
+        count, diff, box = compare(image, reference, mask)
+    except (OSError, ValueError) as e:
+        sys.exit("%s: %s" % (args.reference, e))
+    if args.diff:
+        with open(args.diff, "w") as f:
+            f.write(format_pbm(image[0], image[1], diff))
+    if count == 0:
+        print("%s: OK" % args.reference)
+        return 0
+    print("%s: %d pixels differ in x=%d..%d y=%d..%d"
+          % (args.reference, count, box[0], box[2], box[1], box[3]))
+    return 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
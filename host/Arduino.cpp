@@ -0,0 +1,274 @@
+/**************************************************************************/
+/*!
+  @file     Arduino.cpp
+
+  Arduino K197Display sketch
+
+  Copyright (C) 2022 by ALX2009
+
+  License: MIT (see LICENSE)
+
+  This file is part of the Arduino K197Display sketch, please see
+  https://github.com/alx2009/K197Display for more information
+
+  Host build: implementation of Arduino.h, avr/io.h, SPI.h, EEPROM.h and of
+  the harness functions in host.h
+*/
+/**************************************************************************/
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <SPI.h>
+
+#include "../pinout.h"
+#include "host.h"
+
+// ***************************************************************************************
+// Peripherals
+// ***************************************************************************************
+
+PORT_t PORTA, PORTC, PORTD, PORTF;
+// all the inputs high: buttons released, SPI1 not selected
+VPORT_t VPORTA = {0, 0, 0xff, 0}, VPORTC = {0, 0, 0xff, 0},
+        VPORTD = {0, 0, 0xff, 0}, VPORTF = {0, 0, 0xff, 0};
+SPI_t SPI0, SPI1;
+TCA_t TCA0;
+CCL_t CCL;
+EVSYS_t EVSYS;
+CPUINT_t CPUINT;
+RSTCTRL_t RSTCTRL;
+GPR_t GPR;
+SIGROW_t SIGROW = {1024, 3241}; // 25.1C with analogRead() below
+MVIO_t MVIO = {MVIO_VDDIO2S_bm};
+WDT_t WDT;
+USART_t USART0, USART1;
+
+SPIClass SPI;
+EEPROMClass EEPROM;
+HardwareSerial Serial;
+
+SPI_DATA_t::operator uint8_t() {
+  *intflags &= ~SPI_RXCIF_bm;
+  return rx;
+}
+
+// ***************************************************************************************
+// Time and random numbers
+// ***************************************************************************************
+
+static unsigned long host_us = 0UL; ///< the simulated time
+
+unsigned long micros() { return host_us; }
+unsigned long millis() { return host_us / 1000UL; }
+void delay(unsigned long ms) { host_us += ms * 1000UL; }
+
+/*!
+    @brief  advance the simulated time
+    @param us the time to add (microseconds)
+*/
+void hostAdvance(unsigned long us) { host_us += us; }
+
+static unsigned long random_state = 1UL; ///< same generator on every host
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0)
+    random_state = seed;
+}
+
+long random(long howbig) {
+  if (howbig <= 0)
+    return 0;
+  random_state = random_state * 1103515245UL + 12345UL;
+  return ((random_state >> 1) & 0x7fffffffUL) % howbig;
+}
+
+long random(long howsmall, long howbig) {
+  if (howsmall >= howbig)
+    return howsmall;
+  return random(howbig - howsmall) + howsmall;
+}
+
+// ***************************************************************************************
+// Pins
+// ***************************************************************************************
+
+void pinMode(uint8_t pin, uint8_t mode) { (void)pin, (void)mode; }
+void pinConfigure(uint8_t pin, uint16_t mode) { (void)pin, (void)mode; }
+void digitalWriteFast(uint8_t pin, uint8_t val) { (void)pin, (void)val; }
+uint8_t digitalReadFast(uint8_t pin) { return pin == BT_POWER ? LOW : HIGH; }
+int analogRead(uint8_t pin) { return pin == ADC_TEMPERATURE ? 2048 : 1000; }
+void analogReference(uint8_t mode) { (void)mode; }
+bool analogReadResolution(uint8_t res) { return res == 12; }
+void attachInterrupt(uint8_t pin, void (*userFunc)(void), uint8_t mode) {
+  (void)pin, (void)userFunc, (void)mode;
+}
+void takeOverTCA0() {}
+
+char *dtostrf(double val, signed char width, unsigned char prec, char *sout) {
+  sprintf(sout, "%*.*f", width, prec, val);
+  return sout;
+}
+
+// ***************************************************************************************
+// K197 SPI interface
+// ***************************************************************************************
+
+ISR(SPI1_PORT_vect);
+ISR(SPI1_INT_vect);
+
+/*!
+    @brief  receive a byte with the SPI1 peripheral
+    @param c the byte
+    @param command true for a command byte (MB_CD high)
+*/
+static void receiveByte(byte c, bool command) {
+  if (command)
+    SPI1_VPORT.IN |= MB_CD_bm;
+  else
+    SPI1_VPORT.IN &= ~MB_CD_bm;
+  SPI1.DATA.rx = c;
+  SPI1.INTFLAGS |= SPI_RXCIF_bm;
+  SPI1_INT_vect();
+}
+
+/*!
+    @brief  simulate a frame sent by the K197
+    @details the K197 selects the device, sends a few commands and the data
+   bytes, then de-selects the device. The interrupt handlers in SPIdevice.cpp
+   are called as with the real hardware
+    @param data the data bytes
+    @param n the number of data bytes
+*/
+void hostReceiveFrame(const byte *data, byte n) {
+  SPI1_VPORT.IN &= ~SPI1_SS_bm; // selected
+  SPI1_PORT_vect();
+  for (byte i = 0; i < 3; i++)
+    receiveByte(0x00, true);
+  for (byte i = 0; i < n; i++)
+    receiveByte(data[i], false);
+  SPI1_VPORT.IN |= SPI1_SS_bm; // de-selected
+  SPI1_PORT_vect();
+}
+
+// ***************************************************************************************
+// Print and Stream, same as the Arduino core
+// ***************************************************************************************
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size-- > 0)
+    n += write(*buffer++);
+  return n;
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base) {
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if (base < 2)
+    base = 10;
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return write(str);
+}
+
+size_t Print::printFloat(double number, uint8_t digits) {
+  if (isnan(number))
+    return print("nan");
+  if (isinf(number))
+    return print("inf");
+  if (number > 4294967040.0 || number < -4294967040.0)
+    return print("ovf");
+  size_t n = 0;
+  if (number < 0.0) {
+    n += print('-');
+    number = -number;
+  }
+  double rounding = 0.5;
+  for (uint8_t i = 0; i < digits; ++i)
+    rounding /= 10.0;
+  number += rounding;
+  unsigned long int_part = (unsigned long)number;
+  double remainder = number - (double)int_part;
+  n += print(int_part);
+  if (digits > 0)
+    n += print('.');
+  while (digits-- > 0) {
+    remainder *= 10.0;
+    unsigned int toPrint = (unsigned int)remainder;
+    n += print(toPrint);
+    remainder -= toPrint;
+  }
+  return n;
+}
+
+size_t Print::print(const __FlashStringHelper *ifsh) {
+  return write(reinterpret_cast<const char *>(ifsh));
+}
+size_t Print::print(const char str[]) { return write(str); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(unsigned char n, int base) {
+  return print((unsigned long)n, base);
+}
+size_t Print::print(int n, int base) { return print((long)n, base); }
+size_t Print::print(unsigned int n, int base) {
+  return print((unsigned long)n, base);
+}
+size_t Print::print(long n, int base) {
+  if (base == 10 && n < 0)
+    return print('-') + printNumber(-(unsigned long)n, 10);
+  return printNumber(n, base);
+}
+size_t Print::print(unsigned long n, int base) { return printNumber(n, base); }
+size_t Print::print(double n, int digits) { return printFloat(n, digits); }
+
+size_t Print::println(void) { return write("\r\n"); }
+size_t Print::println(const __FlashStringHelper *ifsh) {
+  return print(ifsh) + println();
+}
+size_t Print::println(const char c[]) { return print(c) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(unsigned char b, int base) {
+  return print(b, base) + println();
+}
+size_t Print::println(int num, int base) {
+  return print(num, base) + println();
+}
+size_t Print::println(unsigned int num, int base) {
+  return print(num, base) + println();
+}
+size_t Print::println(long num, int base) {
+  return print(num, base) + println();
+}
+size_t Print::println(unsigned long num, int base) {
+  return print(num, base) + println();
+}
+size_t Print::println(double num, int digits) {
+  return print(num, digits) + println();
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length) {
+  size_t index = 0;
+  while (index < length) {
+    int c = read();
+    if (c < 0 || c == terminator)
+      break;
+    *buffer++ = (char)c;
+    index++;
+  }
+  return index;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (c != '\r') // the host terminal only needs '\n'
+    putchar(c);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  for (size_t i = 0; i < size; i++)
+    write(buffer[i]);
+  return size;
+}
@@ -0,0 +1,243 @@
+/**************************************************************************/
+/*!
+  @file     Arduino.h
+
+  Arduino K197Display sketch
+
+  Copyright (C) 2022 by ALX2009
+
+  License: MIT (see LICENSE)
+
+  This file is part of the Arduino K197Display sketch, please see
+  https://github.com/alx2009/K197Display for more information
+
+  Host build: the part of the Arduino/dxCore API used by the sketch, so that
+  the sketch sources can be compiled and run on a PC (see CMakeLists.txt).
+
+  Only what the sketch actually uses is provided. Time is simulated (see
+  host.h) and the pins do nothing. PROGMEM data is in normal memory, so the
+  pgm_read_xxx() functions are plain memory reads.
+*/
+/**************************************************************************/
+#ifndef HOST_ARDUINO_H__
+#define HOST_ARDUINO_H__
+
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+typedef uint8_t byte; ///< same as the Arduino core
+
+// ***************************************************************************************
+// PROGMEM
+// ***************************************************************************************
+
+#define PROGMEM          ///< no separate flash address space on the host
+#define PSTR(s) (s)      ///< no separate flash address space on the host
+#define PGM_P const char * ///< pointer to a PROGMEM string
+
+class __FlashStringHelper;
+#define F(s)                                                                   \
+  (reinterpret_cast<const __FlashStringHelper *>(s)) ///< same as the core
+
+/*!
+    @brief  same as avr-libc, without aliasing problems on the host
+    @param p address of the data
+    @return the data
+*/
+template <typename T> inline T pgm_read(const void *p) {
+  T value;
+  memcpy(&value, p, sizeof(T));
+  return value;
+}
+#define pgm_read_byte(p) pgm_read<uint8_t>(p)    ///< read PROGMEM byte
+#define pgm_read_word(p) pgm_read<uint16_t>(p)   ///< read PROGMEM word
+#define pgm_read_dword(p) pgm_read<uint32_t>(p)  ///< read PROGMEM dword
+#define pgm_read_float(p) pgm_read<float>(p)     ///< read PROGMEM float
+#define pgm_read_ptr(p) pgm_read<const void *>(p) ///< read PROGMEM pointer
+#define memcpy_P memcpy                             ///< same as memcpy()
+#define strcasecmp_P strcasecmp                     ///< same as strcasecmp()
+#define strncmp_P strncmp                           ///< same as strncmp()
+#define strlen_P strlen                             ///< same as strlen()
+
+// ***************************************************************************************
+// Pins and constants
+// ***************************************************************************************
+
+#define __AVR_DB__      ///< the host stands in for an AVR DB (see pinout.h)
+#define DB_28_PINS      ///< the sketch requires a 28 pin AVR DB
+#define CORE_ATTACH_NONE ///< attachInterrupt set to "only enabled ports"
+
+#define PIN_PA0 0  ///< dxCore pin number
+#define PIN_PA1 1  ///< dxCore pin number
+#define PIN_PA2 2  ///< dxCore pin number
+#define PIN_PA3 3  ///< dxCore pin number
+#define PIN_PA4 4  ///< dxCore pin number
+#define PIN_PA5 5  ///< dxCore pin number
+#define PIN_PA6 6  ///< dxCore pin number
+#define PIN_PA7 7  ///< dxCore pin number
+#define PIN_PC0 8  ///< dxCore pin number
+#define PIN_PC1 9  ///< dxCore pin number
+#define PIN_PC2 10 ///< dxCore pin number
+#define PIN_PC3 11 ///< dxCore pin number
+#define PIN_PD1 13 ///< dxCore pin number
+#define PIN_PD2 14 ///< dxCore pin number
+#define PIN_PD3 15 ///< dxCore pin number
+#define PIN_PD4 16 ///< dxCore pin number
+#define PIN_PD5 17 ///< dxCore pin number
+#define PIN_PD6 18 ///< dxCore pin number
+#define PIN_PD7 19 ///< dxCore pin number
+#define PIN_PF0 20 ///< dxCore pin number
+#define PIN_PF1 21 ///< dxCore pin number
+#define LED_BUILTIN PIN_PA7 ///< same as dxCore
+
+#define LOW 0           ///< pin level
+#define HIGH 1          ///< pin level
+#define INPUT 0         ///< pin mode
+#define OUTPUT 1        ///< pin mode
+#define INPUT_PULLUP 2  ///< pin mode
+#define CHANGE 1        ///< interrupt mode
+
+#define PIN_DIR_INPUT 0x0001     ///< pinConfigure() option
+#define PIN_DIR_OUTPUT 0x0002    ///< pinConfigure() option
+#define PIN_OUT_LOW 0x0004       ///< pinConfigure() option
+#define PIN_OUT_HIGH 0x0008      ///< pinConfigure() option
+#define PIN_PULLUP_ON 0x0010     ///< pinConfigure() option
+#define PIN_PULLUP_OFF 0x0020    ///< pinConfigure() option
+#define PIN_INLVL_SCHMITT 0x0040 ///< pinConfigure() option
+#define PIN_INPUT_ENABLE 0x0080  ///< pinConfigure() option
+#define PIN_INVERT_OFF 0x0100    ///< pinConfigure() option
+#define PIN_ISC_ENABLE 0x0200    ///< pinConfigure() option
+
+#define INTERNAL1V024 1    ///< analog reference
+#define INTERNAL2V048 2    ///< analog reference
+#define ADC_TEMPERATURE 0x42 ///< analog channel
+#define ADC_VDDDIV10 0x44    ///< analog channel
+#define ADC_VDDIO2DIV10 0x45 ///< analog channel
+
+#define DEC 10 ///< base for Print
+#define HEX 16 ///< base for Print
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01) ///< same as the core
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))  ///< same as the core
+#define bitClear(value, bit)                                                   \
+  ((value) &= ~(1UL << (bit))) ///< same as the core
+#define isDigit(c) (isdigit(c) != 0) ///< same as the core
+
+// ***************************************************************************************
+// Functions
+// ***************************************************************************************
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void pinConfigure(uint8_t pin, uint16_t mode);
+void digitalWriteFast(uint8_t pin, uint8_t val);
+uint8_t digitalReadFast(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogReference(uint8_t mode);
+bool analogReadResolution(uint8_t res);
+void attachInterrupt(uint8_t pin, void (*userFunc)(void), uint8_t mode);
+void takeOverTCA0();
+
+char *dtostrf(double val, signed char width, unsigned char prec, char *sout);
+
+// ***************************************************************************************
+// Print, Stream and Serial
+// ***************************************************************************************
+
+/**************************************************************************/
+/*!
+    @brief  same interface as the Arduino Print class
+*/
+/**************************************************************************/
+class Print {
+  size_t printNumber(unsigned long n, uint8_t base);
+  size_t printFloat(double number, uint8_t digits);
+
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) {
+    return str == NULL ? 0 : write((const uint8_t *)str, strlen(str));
+  };
+  size_t write(const char *buffer, size_t size) {
+    return write((const uint8_t *)buffer, size);
+  };
+  virtual int availableForWrite() { return 0; };
+  virtual void flush(){};
+
+  size_t print(const __FlashStringHelper *ifsh);
+  size_t print(const char str[]);
+  size_t print(char c);
+  size_t print(unsigned char n, int base = DEC);
+  size_t print(int n, int base = DEC);
+  size_t print(unsigned int n, int base = DEC);
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(double n, int digits = 2);
+
+  size_t println(const __FlashStringHelper *ifsh);
+  size_t println(const char str[]);
+  size_t println(char c);
+  size_t println(unsigned char n, int base = DEC);
+  size_t println(int n, int base = DEC);
+  size_t println(unsigned int n, int base = DEC);
+  size_t println(long n, int base = DEC);
+  size_t println(unsigned long n, int base = DEC);
+  size_t println(double n, int digits = 2);
+  size_t println(void);
+};
+
+/**************************************************************************/
+/*!
+    @brief  same interface as the Arduino Stream class
+*/
+/**************************************************************************/
+class Stream : public Print {
+protected:
+  unsigned long timeout = 1000UL; ///< not used, there is no input
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  void setTimeout(unsigned long ms) { timeout = ms; };
+  size_t readBytesUntil(char terminator, char *buffer, size_t length);
+};
+
+/**************************************************************************/
+/*!
+    @brief  Serial port, the output goes to stdout and there is no input
+*/
+/**************************************************************************/
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud) { (void)baud; };
+  void end(){};
+  int available() override { return 0; };
+  int read() override { return -1; };
+  int availableForWrite() override { return 64; };
+  void flush() override { fflush(stdout); };
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  operator bool() { return true; };
+};
+extern HardwareSerial Serial; ///< the serial port
+
+#endif // HOST_ARDUINO_H__
@@ -0,0 +1,62 @@
+/**************************************************************************/
+/*!
+  @file     EEPROM.h
+
+  Arduino K197Display sketch
+
+  Copyright (C) 2022 by ALX2009
+
+  License: MIT (see LICENSE)
+
+  This file is part of the Arduino K197Display sketch, please see
+  https://github.com/alx2009/K197Display for more information
+
+  Host build: the EEPROM is a RAM array, erased (0xff) at the start
+*/
+/**************************************************************************/
+#ifndef HOST_EEPROM_H__
+#define HOST_EEPROM_H__
+#include <Arduino.h>
+
+/**************************************************************************/
+/*!
+    @brief  same interface as the Arduino EEPROM library (only what is used)
+*/
+/**************************************************************************/
+struct EEPROMClass {
+  static const uint16_t size = 512; ///< same as the AVR64DB28
+  uint8_t data[size];               ///< the content of the EEPROM
+
+  EEPROMClass() { memset(data, 0xff, sizeof(data)); };
+
+  /*!
+     @brief  read an object from the EEPROM
+     @param idx the address of the object
+     @param t the object
+     @return t
+  */
+  template <typename T> T &get(int idx, T &t) {
+    memcpy(&t, &data[idx], sizeof(T));
+    return t;
+  };
+
+  /*!
+     @brief  write an object to the EEPROM
+     @param idx the address of the object
+     @param t the object
+     @return t
+  */
+  template <typename T> const T &put(int idx, const T &t) {
+    memcpy(&data[idx], &t, sizeof(T));
+    return t;
+  };
+
+  /*!
+     @brief  get the size of the EEPROM
+     @return the size in bytes
+  */
+  uint16_t length() { return size; };
+};
+extern EEPROMClass EEPROM; ///< the EEPROM
+
+#endif // HOST_EEPROM_H__
@@ -0,0 +1,39 @@
+/**************************************************************************/
+/*!
+  @file     SPI.h
+
+  Arduino K197Display sketch
+
+  Copyright (C) 2022 by ALX2009
+
+  License: MIT (see LICENSE)
+
+  This file is part of the Arduino K197Display sketch, please see
+  https://github.com/alx2009/K197Display for more information
+
+  Host build: the SPI library is only used to select the pins
+*/
+/**************************************************************************/
+#ifndef HOST_SPI_H__
+#define HOST_SPI_H__
+#include <Arduino.h>
+
+#define SPI0_SWAP_DEFAULT 0 ///< same as dxCore
+
+/**************************************************************************/
+/*!
+    @brief  same interface as the dxCore SPI library (only what is used)
+*/
+/**************************************************************************/
+class SPIClass {
+public:
+  /*!
+     @brief  select the pins used by SPI0
+     @param option the pin mapping
+     @return true if the mapping is valid
+  */
+  bool swap(uint8_t option) { return option == SPI0_SWAP_DEFAULT; };
+};
+extern SPIClass SPI; ///< the SPI0 peripheral, used by u8g2
+
+#endif // HOST_SPI_H__
@@ -0,0 +1,354 @@
+/**************************************************************************/
+/*!
+  @file     U8g2lib.cpp
+
+  Arduino K197Display sketch
+
+  Copyright (C) 2022 by ALX2009
+
+  License: MIT (see LICENSE)
+
+  This file is part of the Arduino K197Display sketch, please see
+  https://github.com/alx2009/K197Display for more information
+
+  Host build: implementation of the host u8g2, see U8g2lib.h
+*/
+/**************************************************************************/
+#include "U8g2lib.h"
+#include "host.h"
+
+static const u8g2_cb_t rotation0 = {0}; ///< no rotation
+const u8g2_cb_t *U8G2_R0 = &rotation0;
+
+// {width, max char height, ascent, descent}, close to the real u8g2 fonts
+const uint8_t u8g2_font_5x7_mr[] = {5, 7, 6, 1};
+const uint8_t u8g2_font_6x12_mr[] = {6, 12, 9, 2};
+const uint8_t u8g2_font_8x13_mr[] = {8, 13, 9, 2};
+const uint8_t u8g2_font_9x15_m_symbols[] = {9, 15, 10, 3};
+const uint8_t u8g2_font_inr16_mr[] = {13, 22, 16, 5};
+const uint8_t u8g2_font_inr30_mr[] = {25, 41, 30, 9};
+
+host_display_stats hostDisplayStats;
+
+static uint8_t display_ram[256 / 8 * 64]; ///< what has been sent
+
+/*!
+    @brief  get the content of the display
+    @details the data sent with sendBuffer() and updateDisplayArea(), in the
+   same format as U8G2::getBufferPtr()
+    @return pointer to the display RAM
+*/
+const uint8_t *hostDisplayRam() { return display_ram; }
+
+/// 5x7 glyphs for the characters 0x20 to 0x7e, one byte for each column
+/// (bit 0 is the top row)
+static const uint8_t ascii_glyphs[][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5f, 0x00, 0x00}, // ' ' !
+    {0x00, 0x07, 0x00, 0x07, 0x00}, {0x14, 0x7f, 0x14, 0x7f, 0x14}, // " #
+    {0x24, 0x2a, 0x7f, 0x2a, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62}, // $ %
+    {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, // & '
+    {0x00, 0x1c, 0x22, 0x41, 0x00}, {0x00, 0x41, 0x22, 0x1c, 0x00}, // ( )
+    {0x14, 0x08, 0x3e, 0x08, 0x14}, {0x08, 0x08, 0x3e, 0x08, 0x08}, // * +
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, // , -
+    {0x00, 0x60, 0x60, 0x00, 0x00}, {0x20, 0x10, 0x08, 0x04, 0x02}, // . /
+    {0x3e, 0x51, 0x49, 0x45, 0x3e}, {0x00, 0x42, 0x7f, 0x40, 0x00}, // 0 1
+    {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4b, 0x31}, // 2 3
+    {0x18, 0x14, 0x12, 0x7f, 0x10}, {0x27, 0x45, 0x45, 0x45, 0x39}, // 4 5
+    {0x3c, 0x4a, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03}, // 6 7
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1e}, // 8 9
+    {0x00, 0x36, 0x36, 0x00, 0x00}, {0x00, 0x56, 0x36, 0x00, 0x00}, // : ;
+    {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14}, // < =
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, // > ?
+    {0x32, 0x49, 0x79, 0x41, 0x3e}, {0x7e, 0x11, 0x11, 0x11, 0x7e}, // @ A
+    {0x7f, 0x49, 0x49, 0x49, 0x36}, {0x3e, 0x41, 0x41, 0x41, 0x22}, // B C
+    {0x7f, 0x41, 0x41, 0x22, 0x1c}, {0x7f, 0x49, 0x49, 0x49, 0x41}, // D E
+    {0x7f, 0x09, 0x09, 0x09, 0x01}, {0x3e, 0x41, 0x49, 0x49, 0x7a}, // F G
+    {0x7f, 0x08, 0x08, 0x08, 0x7f}, {0x00, 0x41, 0x7f, 0x41, 0x00}, // H I
+    {0x20, 0x40, 0x41, 0x3f, 0x01}, {0x7f, 0x08, 0x14, 0x22, 0x41}, // J K
+    {0x7f, 0x40, 0x40, 0x40, 0x40}, {0x7f, 0x02, 0x0c, 0x02, 0x7f}, // L M
+    {0x7f, 0x04, 0x08, 0x10, 0x7f}, {0x3e, 0x41, 0x41, 0x41, 0x3e}, // N O
+    {0x7f, 0x09, 0x09, 0x09, 0x06}, {0x3e, 0x41, 0x51, 0x21, 0x5e}, // P Q
+    {0x7f, 0x09, 0x19, 0x29, 0x46}, {0x46, 0x49, 0x49, 0x49, 0x31}, // R S
+    {0x01, 0x01, 0x7f, 0x01, 0x01}, {0x3f, 0x40, 0x40, 0x40, 0x3f}, // T U
+    {0x1f, 0x20, 0x40, 0x20, 0x1f}, {0x3f, 0x40, 0x38, 0x40, 0x3f}, // V W
+    {0x63, 0x14, 0x08, 0x14, 0x63}, {0x07, 0x08, 0x70, 0x08, 0x07}, // X Y
+    {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7f, 0x41, 0x41, 0x00}, // Z [
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7f, 0x00}, // \ ]
+    {0x04, 0x02, 0x01, 0x02, 0x04}, {0x40, 0x40, 0x40, 0x40, 0x40}, // ^ _
+    {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78}, // ` a
+    {0x7f, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20}, // b c
+    {0x38, 0x44, 0x44, 0x48, 0x7f}, {0x38, 0x54, 0x54, 0x54, 0x18}, // d e
+    {0x08, 0x7e, 0x09, 0x01, 0x02}, {0x0c, 0x52, 0x52, 0x52, 0x3e}, // f g
+    {0x7f, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7d, 0x40, 0x00}, // h i
+    {0x20, 0x40, 0x44, 0x3d, 0x00}, {0x7f, 0x10, 0x28, 0x44, 0x00}, // j k
+    {0x00, 0x41, 0x7f, 0x40, 0x00}, {0x7c, 0x04, 0x18, 0x04, 0x78}, // l m
+    {0x7c, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, // n o
+    {0x7c, 0x14, 0x14, 0x14, 0x08}, {0x08, 0x14, 0x14, 0x18, 0x7c}, // p q
+    {0x7c, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20}, // r s
+    {0x04, 0x3f, 0x44, 0x40, 0x20}, {0x3c, 0x40, 0x40, 0x20, 0x7c}, // t u
+    {0x1c, 0x20, 0x40, 0x20, 0x1c}, {0x3c, 0x40, 0x30, 0x40, 0x3c}, // v w
+    {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0c, 0x50, 0x50, 0x50, 0x3c}, // x y
+    {0x44, 0x64, 0x54, 0x4c, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, // z {
+    {0x00, 0x00, 0x7f, 0x00, 0x00}, {0x00, 0x41, 0x36, 0x08, 0x00}, // | }
+    {0x08, 0x04, 0x08, 0x10, 0x08}                                  // ~
+};
+
+/// glyphs for the other characters used by the sketch
+static const struct {
+  uint16_t code;     ///< unicode code point
+  uint8_t glyph[5];  ///< same as ascii_glyphs
+} other_glyphs[] = {
+    {0x00b0, {0x00, 0x06, 0x09, 0x09, 0x06}}, // °
+    {0x00b5, {0x7c, 0x20, 0x20, 0x10, 0x3c}}, // µ
+    {0x03a9, {0x58, 0x64, 0x04, 0x64, 0x58}}, // Ω
+    {0x25f4, {0x1c, 0x2e, 0x4f, 0x41, 0x3e}}, // doodle, see displayDoodle()
+    {0x25f5, {0x1c, 0x22, 0x41, 0x4f, 0x3e}}, // doodle
+    {0x25f6, {0x3e, 0x41, 0x79, 0x22, 0x1c}}, // doodle
+    {0x25f7, {0x3e, 0x79, 0x79, 0x22, 0x1c}}, // doodle
+};
+
+static const uint8_t missing_glyph[5] = {0x7f, 0x41, 0x41, 0x41, 0x7f};
+
+/*!
+    @brief  find the glyph for a character
+    @param code the unicode code point
+    @return the 5 columns of the glyph
+*/
+static const uint8_t *findGlyph(uint16_t code) {
+  if (code >= 0x20 && code <= 0x7e)
+    return ascii_glyphs[code - 0x20];
+  for (const auto &g : other_glyphs) {
+    if (g.code == code)
+      return g.glyph;
+  }
+  return missing_glyph;
+}
+
+U8G2::U8G2() {
+  memset(buffer, 0, sizeof(buffer));
+  font = u8g2_font_5x7_mr;
+}
+
+/*!
+    @brief  change a pixel in the buffer, clipped to the clip window
+    @param x the x coordinate
+    @param y the y coordinate
+    @param color 0: clear, 1: set, 2: XOR
+*/
+void U8G2::setPixel(u8g2_uint_t x, u8g2_uint_t y, uint8_t color) {
+  if (x < clip_x0 || x >= clip_x1 || y < clip_y0 || y >= clip_y1)
+    return;
+  uint8_t *p = &buffer[(y / 8) * width + x];
+  uint8_t mask = 1 << (y % 8);
+  if (color == 0)
+    *p &= ~mask;
+  else if (color == 1)
+    *p |= mask;
+  else
+    *p ^= mask;
+  hostDisplayStats.pixels++;
+}
+
+/*!
+    @brief  limit the drawing to a window (the display is the maximum)
+    @param x0 the first column
+    @param y0 the first line
+    @param x1 the column after the last one
+    @param y1 the line after the last one
+*/
+void U8G2::setClipWindow(u8g2_uint_t x0, u8g2_uint_t y0, u8g2_uint_t x1,
+                         u8g2_uint_t y1) {
+  clip_x0 = x0;
+  clip_y0 = y0;
+  clip_x1 = x1 < width ? x1 : width;
+  clip_y1 = y1 < height ? y1 : height;
+}
+
+void U8G2::clearBuffer() {
+  hostDisplayStats.draw_calls++;
+  memset(buffer, 0, sizeof(buffer));
+}
+
+void U8G2::sendBuffer() {
+  memcpy(display_ram, buffer, sizeof(buffer));
+  hostDisplayStats.tiles_sent += sizeof(buffer) / 8;
+}
+
+void U8G2::updateDisplayArea(uint8_t tile_x, uint8_t tile_y, uint8_t tile_w,
+                             uint8_t tile_h) {
+  for (uint8_t r = tile_y; r < tile_y + tile_h; r++) {
+    size_t offset = r * width + tile_x * 8;
+    memcpy(display_ram + offset, buffer + offset, tile_w * 8);
+  }
+  hostDisplayStats.tiles_sent += tile_w * tile_h;
+}
+
+void U8G2::drawPixel(u8g2_uint_t x, u8g2_uint_t y) {
+  hostDisplayStats.draw_calls++;
+  setPixel(x, y, draw_color);
+}
+
+void U8G2::drawVLine(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t h) {
+  hostDisplayStats.draw_calls++;
+  for (u8g2_uint_t i = 0; i < h; i++)
+    setPixel(x, y + i, draw_color);
+}
+
+void U8G2::drawLine(u8g2_uint_t x0, u8g2_uint_t y0, u8g2_uint_t x1,
+                    u8g2_uint_t y1) {
+  hostDisplayStats.draw_calls++;
+  int dx = abs(int(x1) - int(x0));
+  int dy = -abs(int(y1) - int(y0));
+  int sx = x0 < x1 ? 1 : -1;
+  int sy = y0 < y1 ? 1 : -1;
+  int err = dx + dy;
+  int x = x0;
+  int y = y0;
+  while (true) { // Bresenham
+    setPixel(x, y, draw_color);
+    if (x == x1 && y == y1)
+      break;
+    int e2 = 2 * err;
+    if (e2 >= dy) {
+      err += dy;
+      x += sx;
+    }
+    if (e2 <= dx) {
+      err += dx;
+      y += sy;
+    }
+  }
+}
+
+void U8G2::drawBox(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w,
+                   u8g2_uint_t h) {
+  hostDisplayStats.draw_calls++;
+  for (u8g2_uint_t j = 0; j < h; j++) {
+    for (u8g2_uint_t i = 0; i < w; i++)
+      setPixel(x + i, y + j, draw_color);
+  }
+}
+
+void U8G2::drawFrame(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w,
+                     u8g2_uint_t h) {
+  hostDisplayStats.draw_calls++;
+  if (w == 0 || h == 0)
+    return;
+  for (u8g2_uint_t i = 0; i < w; i++) {
+    setPixel(x + i, y, draw_color);
+    setPixel(x + i, y + h - 1, draw_color);
+  }
+  for (u8g2_uint_t j = 1; j + 1 < h; j++) {
+    setPixel(x, y + j, draw_color);
+    setPixel(x + w - 1, y + j, draw_color);
+  }
+}
+
+/*!
+    @brief  draw a character with the current font
+    @details the 5x7 glyph is scaled to the width and ascent of the font. The
+   position is the top left corner (setFontPosTop() is the only mode used by
+   the sketch). In solid font mode the background is drawn as well
+    @param x the x coordinate
+    @param y the y coordinate
+    @param encoding the unicode code point
+    @return the width of the character
+*/
+u8g2_uint_t U8G2::drawGlyph(u8g2_uint_t x, u8g2_uint_t y, uint16_t encoding) {
+  hostDisplayStats.draw_calls++;
+  const uint8_t *glyph = findGlyph(encoding);
+  u8g2_uint_t w = font[0];
+  u8g2_uint_t gw = w <= 6 ? 5 : w - w / 6;   // glyph width, then a space
+  u8g2_uint_t gh = font[2] < 7 ? 7 : font[2]; // glyph height
+  for (u8g2_uint_t i = 0; i < gw; i++) {
+    uint8_t column = glyph[i * 5 / gw];
+    for (u8g2_uint_t j = 0; j < gh; j++) {
+      if (column & (1 << (j * 7 / gh)))
+        setPixel(x + i, y + j, draw_color);
+      else if (font_mode == 0 && draw_color < 2)
+        setPixel(x + i, y + j, !draw_color);
+    }
+  }
+  return w;
+}
+
+u8g2_uint_t U8G2::drawStr(u8g2_uint_t x, u8g2_uint_t y, const char *s) {
+  u8g2_uint_t x0 = x;
+  while (*s != 0)
+    x += drawGlyph(x, y, (uint8_t)*s++);
+  return x - x0;
+}
+
+/*!
+    @brief  print a character at (tx, ty), decoding UTF-8
+    @param c the next byte of the text
+    @return 1
+*/
+size_t U8G2::write(uint8_t c) {
+  if (utf8_state > 0 && (c & 0xc0) == 0x80) { // continuation byte
+    utf8_code = (utf8_code << 6) | (c & 0x3f);
+    if (--utf8_state > 0)
+      return 1;
+  } else if ((c & 0xe0) == 0xc0) {
+    utf8_code = c & 0x1f;
+    utf8_state = 1;
+    return 1;
+  } else if ((c & 0xf0) == 0xe0) {
+    utf8_code = c & 0x0f;
+    utf8_state = 2;
+    return 1;
+  } else {
+    utf8_state = 0;
+    utf8_code = c;
+  }
+  if (utf8_code >= 0x20)
+    tx += drawGlyph(tx, ty, utf8_code);
+  return 1;
+}
+
+void U8G2::drawLog(u8g2_uint_t x, u8g2_uint_t y, U8G2LOG &log) {
+  for (uint8_t line = 0; line < log.height; line++) {
+    const uint8_t *s = log.buffer + line * log.width;
+    for (uint8_t i = 0; i < log.width && s[i] != 0; i++)
+      drawGlyph(x + i * font[0], y + line * font[1], s[i]);
+  }
+}
+
+void U8G2LOG::begin(uint8_t w, uint8_t h, uint8_t *buf) {
+  buffer = buf;
+  width = w;
+  height = h;
+  memset(buffer, 0, w * h);
+  cursor_x = cursor_y = 0;
+}
+
+/*!
+    @brief  start a new line, scrolling the window up when it is full
+*/
+void U8G2LOG::newLine() {
+  cursor_x = 0;
+  if (cursor_y + 1 < height) {
+    cursor_y++;
+    return;
+  }
+  memmove(buffer, buffer + width, width * (height - 1));
+  memset(buffer + width * (height - 1), 0, width);
+}
+
+size_t U8G2LOG::write(uint8_t c) {
+  if (buffer == NULL)
+    return 1;
+  if (c == '\n') {
+    newLine();
+  } else if (c >= 0x20 && c < 0x7f) {
+    if (cursor_x >= width)
+      newLine();
+    buffer[cursor_y * width + cursor_x++] = c;
+  }
+  return 1;
+}
+
+void U8G2LOG::writeString(const char *s) {
+  while (*s != 0)
+    write((uint8_t)*s++);
+}
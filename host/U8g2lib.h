@@ -0,0 +1,180 @@
+/**************************************************************************/
+/*!
+  @file     U8g2lib.h
+
+  Arduino K197Display sketch
+
+  Copyright (C) 2022 by ALX2009
+
+  License: MIT (see LICENSE)
+
+  This file is part of the Arduino K197Display sketch, please see
+  https://github.com/alx2009/K197Display for more information
+
+  Host build: the part of the u8g2 API used by the sketch, drawing in a full
+  frame buffer with the same layout as u8g2 (one byte for 8 vertical pixels,
+  see UImanager.cpp), so that the buffer can be dumped and compared.
+
+  The real fonts are not available on the host. All the fonts are drawn with
+  the same 5x7 glyphs, scaled to the size of the font they replace. The
+  metrics (character width, height and ascent) are close to the real fonts,
+  so the layout is the same, but the screens are not pixel exact copies of
+  what the OLED shows.
+
+  The drawing calls and the pixels drawn are counted, see host.h
+*/
+/**************************************************************************/
+#ifndef HOST_U8G2LIB_H__
+#define HOST_U8G2LIB_H__
+#include <Arduino.h>
+
+#define U8G2_16BIT        ///< required by the sketch, see UImanager.cpp
+#define U8X8_HAVE_HW_SPI  ///< the display is connected to SPI0
+
+typedef uint16_t u8g2_uint_t; ///< same as u8g2 with U8G2_16BIT
+
+/*!
+    @brief  display rotation (only U8G2_R0 is supported)
+*/
+struct u8g2_cb_t {
+  uint8_t rotation; ///< not used
+};
+extern const u8g2_cb_t *U8G2_R0; ///< no rotation
+
+// Fonts: {width, max char height, ascent, descent}, see U8g2lib.cpp
+extern const uint8_t u8g2_font_5x7_mr[];          ///< terminal window
+extern const uint8_t u8g2_font_6x12_mr[];         ///< menus, BAT
+extern const uint8_t u8g2_font_8x13_mr[];         ///< annunciators
+extern const uint8_t u8g2_font_9x15_m_symbols[];  ///< units, doodle
+extern const uint8_t u8g2_font_inr16_mr[];        ///< split screen value
+extern const uint8_t u8g2_font_inr30_mr[];        ///< main value
+
+/**************************************************************************/
+/*!
+    @brief  the u8g2 terminal window (only what is used)
+*/
+/**************************************************************************/
+class U8G2LOG : public Print {
+  uint8_t *buffer = NULL; ///< width*height characters
+  uint8_t width = 0;      ///< characters in a line
+  uint8_t height = 0;     ///< lines
+  uint8_t cursor_x = 0;   ///< position of the next character
+  uint8_t cursor_y = 0;   ///< line of the next character
+  void newLine();
+
+public:
+  void begin(uint8_t w, uint8_t h, uint8_t *buf);
+  size_t write(uint8_t c) override;
+  using Print::write;
+  void writeString(const char *s);
+  friend class U8G2;
+};
+
+/**************************************************************************/
+/*!
+    @brief  the u8g2 full buffer display class (only what is used)
+*/
+/**************************************************************************/
+class U8G2 : public Print {
+  static const u8g2_uint_t width = 256; ///< display width
+  static const u8g2_uint_t height = 64; ///< display height
+  uint8_t buffer[width / 8 * height];   ///< full frame buffer
+  const uint8_t *font = NULL;           ///< current font
+  uint8_t draw_color = 1;               ///< 0: clear, 1: set, 2: XOR
+  uint8_t font_mode = 0;                ///< 0: solid, 1: transparent
+  uint8_t utf8_state = 0;               ///< continuation bytes still to read
+  uint16_t utf8_code = 0;               ///< code point being decoded
+  u8g2_uint_t clip_x0 = 0;              ///< clip window, first column
+  u8g2_uint_t clip_y0 = 0;              ///< clip window, first line
+  u8g2_uint_t clip_x1 = width;          ///< clip window, column after last
+  u8g2_uint_t clip_y1 = height;         ///< clip window, line after last
+
+  void setPixel(u8g2_uint_t x, u8g2_uint_t y, uint8_t color);
+
+public:
+  u8g2_uint_t tx = 0; ///< print() cursor x
+  u8g2_uint_t ty = 0; ///< print() cursor y
+
+  U8G2();
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+  void begin(){};
+  void setBusClock(uint32_t clock_speed) { (void)clock_speed; };
+  void setContrast(uint8_t value) { (void)value; };
+  void enableUTF8Print(){};
+  void clearBuffer();
+  void sendBuffer();
+  void updateDisplayArea(uint8_t tile_x, uint8_t tile_y, uint8_t tile_w,
+                         uint8_t tile_h);
+  uint8_t *getBufferPtr() { return buffer; };
+  uint8_t getBufferTileWidth() { return width / 8; };
+  uint8_t getBufferTileHeight() { return height / 8; };
+  u8g2_uint_t getDisplayWidth() { return width; };
+  u8g2_uint_t getDisplayHeight() { return height; };
+
+  void setFont(const uint8_t *f) { font = f; };
+  void setFontMode(uint8_t is_transparent) { font_mode = is_transparent; };
+  void setFontPosTop(){};
+  void setFontRefHeightExtendedText(){};
+  void setFontDirection(uint8_t dir) { (void)dir; };
+  int8_t getMaxCharWidth() { return font[0]; };
+  int8_t getMaxCharHeight() { return font[1]; };
+  int8_t getAscent() { return font[2]; };
+  u8g2_uint_t getStrWidth(const char *s) { return strlen(s) * font[0]; };
+  void setCursor(u8g2_uint_t x, u8g2_uint_t y) {
+    tx = x;
+    ty = y;
+  };
+
+  void setDrawColor(uint8_t color) { draw_color = color; };
+  void setClipWindow(u8g2_uint_t x0, u8g2_uint_t y0, u8g2_uint_t x1,
+                     u8g2_uint_t y1);
+  void setMaxClipWindow() { setClipWindow(0, 0, width, height); };
+  void drawPixel(u8g2_uint_t x, u8g2_uint_t y);
+  void drawVLine(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t h);
+  void drawLine(u8g2_uint_t x0, u8g2_uint_t y0, u8g2_uint_t x1,
+                u8g2_uint_t y1);
+  void drawBox(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h);
+  void drawFrame(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h);
+  u8g2_uint_t drawGlyph(u8g2_uint_t x, u8g2_uint_t y, uint16_t encoding);
+  u8g2_uint_t drawStr(u8g2_uint_t x, u8g2_uint_t y, const char *s);
+  void drawLog(u8g2_uint_t x, u8g2_uint_t y, U8G2LOG &log);
+};
+
+/*!
+    @brief  the display used with 4 wire SPI
+*/
+class U8G2_SSD1322_NHD_256X64_F_4W_HW_SPI : public U8G2 {
+public:
+  /*!
+     @brief  constructor, the pins are not used
+     @param rotation the display rotation
+     @param cs chip select pin
+     @param dc data/command pin
+     @param reset reset pin
+  */
+  U8G2_SSD1322_NHD_256X64_F_4W_HW_SPI(const u8g2_cb_t *rotation, uint8_t cs,
+                                      uint8_t dc, uint8_t reset = 255) {
+    (void)rotation, (void)cs, (void)dc, (void)reset;
+  };
+};
+
+/*!
+    @brief  the display used with 3 wire SPI
+*/
+class U8G2_SSD1322_NHD_256X64_F_3W_HW_SPI : public U8G2 {
+public:
+  /*!
+     @brief  constructor, the pins are not used
+     @param rotation the display rotation
+     @param cs chip select pin
+     @param reset reset pin
+  */
+  U8G2_SSD1322_NHD_256X64_F_3W_HW_SPI(const u8g2_cb_t *rotation, uint8_t cs,
+                                      uint8_t reset = 255) {
+    (void)rotation, (void)cs, (void)reset;
+  };
+};
+
+#endif // HOST_U8G2LIB_H__
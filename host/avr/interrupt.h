@@ -0,0 +1,27 @@
+/**************************************************************************/
+/*!
+  @file     avr/interrupt.h
+
+  Arduino K197Display sketch
+
+  Copyright (C) 2022 by ALX2009
+
+  License: MIT (see LICENSE)
+
+  This file is part of the Arduino K197Display sketch, please see
+  https://github.com/alx2009/K197Display for more information
+
+  Host build: interrupt handlers are normal functions, called by the test
+  harness to simulate the hardware (see host.h)
+*/
+/**************************************************************************/
+#ifndef HOST_AVR_INTERRUPT_H__
+#define HOST_AVR_INTERRUPT_H__
+
+#define _VECTOR(N) __vector_##N ///< same as avr-libc
+#define ISR(vector) extern "C" void vector(void) ///< interrupt handler
+
+inline void cli() {} ///< there are no interrupts on the host
+inline void sei() {} ///< there are no interrupts on the host
+
+#endif // HOST_AVR_INTERRUPT_H__
@@ -0,0 +1,277 @@
+/**************************************************************************/
+/*!
+  @file     avr/io.h
+
+  Arduino K197Display sketch
+
+  Copyright (C) 2022 by ALX2009
+
+  License: MIT (see LICENSE)
+
+  This file is part of the Arduino K197Display sketch, please see
+  https://github.com/alx2009/K197Display for more information
+
+  Host build: the AVR DB peripherals used by the sketch, as plain variables.
+  The registers have the same names as in the avr-libc header, but only the
+  ones used by the sketch are defined and they have no side effect, except
+  SPI_t::DATA (reading it clears SPI_RXCIF_bm, see host.h).
+*/
+/**************************************************************************/
+#ifndef HOST_AVR_IO_H__
+#define HOST_AVR_IO_H__
+
+#include <stdint.h>
+
+#define F_CPU 24000000UL ///< same as the K197Display board
+
+typedef volatile uint8_t register8_t;   ///< same as avr-libc
+typedef volatile uint16_t register16_t; ///< same as avr-libc
+
+/*!
+    @brief  I/O port
+*/
+struct PORT_t {
+  register8_t DIR;      ///< data direction
+  register8_t OUT;      ///< output value
+  register8_t IN;       ///< input value
+  register8_t INTFLAGS; ///< interrupt flags
+  register8_t PORTCTRL; ///< port control
+  register8_t PIN0CTRL; ///< pin 0 control
+  register8_t PIN1CTRL; ///< pin 1 control
+  register8_t PIN2CTRL; ///< pin 2 control
+  register8_t PIN3CTRL; ///< pin 3 control
+  register8_t PIN4CTRL; ///< pin 4 control
+  register8_t PIN5CTRL; ///< pin 5 control
+  register8_t PIN6CTRL; ///< pin 6 control
+  register8_t PIN7CTRL; ///< pin 7 control
+};
+
+/*!
+    @brief  virtual I/O port
+*/
+struct VPORT_t {
+  register8_t DIR;      ///< data direction
+  register8_t OUT;      ///< output value
+  register8_t IN;       ///< input value
+  register8_t INTFLAGS; ///< interrupt flags
+};
+
+/*!
+    @brief  SPI data register, reading it clears the receive complete flag
+*/
+struct SPI_DATA_t {
+  register8_t *intflags; ///< the INTFLAGS register of the same SPI
+  uint8_t rx = 0;        ///< last byte received
+  uint8_t tx = 0;        ///< last byte written
+  operator uint8_t();
+  SPI_DATA_t &operator=(uint8_t c) {
+    tx = c;
+    return *this;
+  };
+};
+
+/*!
+    @brief  serial peripheral interface
+*/
+struct SPI_t {
+  register8_t CTRLA;    ///< control A
+  register8_t CTRLB;    ///< control B
+  register8_t INTCTRL;  ///< interrupt control
+  register8_t INTFLAGS; ///< interrupt flags
+  SPI_DATA_t DATA;      ///< data
+  SPI_t() { DATA.intflags = &INTFLAGS; };
+};
+
+/*!
+    @brief  16 bit timer/counter type A in normal mode
+*/
+struct TCA_SINGLE_t {
+  register8_t CTRLA;    ///< control A
+  register8_t CTRLB;    ///< control B
+  register8_t CTRLC;    ///< control C
+  register8_t CTRLD;    ///< control D
+  register8_t CTRLECLR; ///< control E clear
+  register8_t CTRLESET; ///< control E set
+  register8_t EVCTRL;   ///< event control
+  register8_t INTCTRL;  ///< interrupt control
+  register8_t INTFLAGS; ///< interrupt flags
+  register16_t CNT;     ///< count
+  register16_t PER;     ///< period
+  register16_t CMP0;    ///< compare 0
+};
+
+/*!
+    @brief  16 bit timer/counter type A
+*/
+struct TCA_t {
+  TCA_SINGLE_t SINGLE; ///< normal mode registers
+};
+
+/*!
+    @brief  configurable custom logic
+*/
+struct CCL_t {
+  register8_t CTRLA;     ///< control A
+  register8_t SEQCTRL0;  ///< sequencer control 0
+  register8_t INTCTRL0;  ///< interrupt control 0
+  register8_t INTFLAGS;  ///< interrupt flags
+  register8_t LUT0CTRLA; ///< LUT 0 control A
+  register8_t LUT0CTRLB; ///< LUT 0 control B
+  register8_t LUT0CTRLC; ///< LUT 0 control C
+  register8_t TRUTH0;    ///< truth table 0
+  register8_t LUT1CTRLA; ///< LUT 1 control A
+  register8_t LUT1CTRLB; ///< LUT 1 control B
+  register8_t LUT1CTRLC; ///< LUT 1 control C
+  register8_t TRUTH1;    ///< truth table 1
+  register8_t LUT2CTRLA; ///< LUT 2 control A
+  register8_t LUT2CTRLB; ///< LUT 2 control B
+  register8_t LUT2CTRLC; ///< LUT 2 control C
+  register8_t TRUTH2;    ///< truth table 2
+  register8_t LUT3CTRLA; ///< LUT 3 control A
+  register8_t LUT3CTRLB; ///< LUT 3 control B
+  register8_t LUT3CTRLC; ///< LUT 3 control C
+  register8_t TRUTH3;    ///< truth table 3
+};
+
+/*!
+    @brief  event system
+*/
+struct EVSYS_t {
+  register8_t CHANNEL2;     ///< channel 2 generator
+  register8_t CHANNEL3;     ///< channel 3 generator
+  register8_t CHANNEL4;     ///< channel 4 generator
+  register8_t CHANNEL5;     ///< channel 5 generator
+  register8_t USERCCLLUT0A; ///< CCL LUT 0 event A user
+  register8_t USERCCLLUT1A; ///< CCL LUT 1 event A user
+  register8_t USERCCLLUT2A; ///< CCL LUT 2 event A user
+  register8_t USERCCLLUT3A; ///< CCL LUT 3 event A user
+};
+
+/*!
+    @brief  interrupt controller
+*/
+struct CPUINT_t {
+  register8_t LVL0PRI; ///< interrupt level 0 priority
+  register8_t LVL1VEC; ///< interrupt level 1 priority vector
+};
+
+/*!
+    @brief  reset controller
+*/
+struct RSTCTRL_t {
+  register8_t RSTFR; ///< reset flags
+  register8_t SWRR;  ///< software reset
+};
+
+/*!
+    @brief  general purpose registers
+*/
+struct GPR_t {
+  register8_t GPR0; ///< general purpose register 0
+};
+
+/*!
+    @brief  signature row
+*/
+struct SIGROW_t {
+  register16_t TEMPSENSE0; ///< temperature calibration 0
+  register16_t TEMPSENSE1; ///< temperature calibration 1
+};
+
+/*!
+    @brief  multi-voltage I/O
+*/
+struct MVIO_t {
+  register8_t STATUS; ///< status
+};
+
+/*!
+    @brief  watchdog timer
+*/
+struct WDT_t {
+  register8_t CTRLA;  ///< control A
+  register8_t STATUS; ///< status
+};
+
+/*!
+    @brief  universal synchronous and asynchronous receiver and transmitter
+*/
+struct USART_t {
+  register8_t CTRLB; ///< control B
+};
+
+extern PORT_t PORTA, PORTC, PORTD, PORTF;
+extern VPORT_t VPORTA, VPORTC, VPORTD, VPORTF;
+extern SPI_t SPI0, SPI1;
+extern TCA_t TCA0;
+extern CCL_t CCL;
+extern EVSYS_t EVSYS;
+extern CPUINT_t CPUINT;
+extern RSTCTRL_t RSTCTRL;
+extern GPR_t GPR;
+extern SIGROW_t SIGROW;
+extern MVIO_t MVIO;
+extern WDT_t WDT;
+extern USART_t USART0, USART1;
+
+#define _PROTECTED_WRITE(reg, value) ((reg) = (value)) ///< no CCP on the host
+
+// Interrupt vectors, see <avr/interrupt.h>
+#define CCL_CCL_vect_num 7       ///< same as the AVR DB
+#define CCL_CCL_vect _VECTOR(7)  ///< same as the AVR DB
+#define TCA0_OVF_vect_num 9      ///< same as the AVR DB
+#define TCA0_OVF_vect _VECTOR(9) ///< same as the AVR DB
+#define TCA0_CMP0_vect_num 11    ///< same as the AVR DB
+#define TCA0_CMP0_vect _VECTOR(11) ///< same as the AVR DB
+#define PORTC_PORT_vect_num 30     ///< same as the AVR DB
+#define PORTC_PORT_vect _VECTOR(30) ///< same as the AVR DB
+#define SPI1_INT_vect_num 37        ///< same as the AVR DB
+#define SPI1_INT_vect _VECTOR(37)   ///< same as the AVR DB
+
+// Bit masks and group configurations (same values as avr-libc)
+#define PORT_ISC_BOTHEDGES_gc 0x01
+#define PORT_SRL_bm 0x01
+#define SPI_ENABLE_bm 0x01
+#define SPI_BUFEN_bm 0x80
+#define SPI_MODE_0_gc 0x00
+#define SPI_RXCIE_bm 0x80
+#define SPI_RXCIF_bm 0x80
+#define SPI_BUFOVF_bm 0x01
+#define TCA_SINGLE_ENABLE_bm 0x01
+#define TCA_SINGLE_CLKSEL_DIV1024_gc 0x0E
+#define TCA_SINGLE_WGMODE_NORMAL_gc 0x00
+#define TCA_SINGLE_CMD_RESET_gc 0x0C
+#define TCA_SINGLE_CNTEI_bm 0x01
+#define TCA_SINGLE_OVF_bm 0x01
+#define TCA_SINGLE_CMP0_bm 0x10
+#define CCL_ENABLE_bm 0x01
+#define CCL_CLKSRC_OSC1K_gc 0x04
+#define CCL_FILTSEL_FILTER_gc 0x20
+#define CCL_INSEL0_EVENTA_gc 0x03
+#define CCL_INSEL1_MASK_gc 0x00
+#define CCL_INSEL2_MASK_gc 0x00
+#define CCL_INTMODE0_BOTH_gc 0x03
+#define CCL_INTMODE1_BOTH_gc 0x0C
+#define CCL_INTMODE2_BOTH_gc 0x30
+#define CCL_INTMODE3_BOTH_gc 0xC0
+#define EVSYS_CHANNEL2_PORTD_PIN5_gc 0x4D
+#define EVSYS_CHANNEL3_PORTD_PIN7_gc 0x4F
+#define EVSYS_CHANNEL4_PORTF_PIN0_gc 0x48
+#define EVSYS_CHANNEL5_PORTF_PIN1_gc 0x49
+#define EVSYS_USER_CHANNEL2_gc 0x03
+#define EVSYS_USER_CHANNEL3_gc 0x04
+#define EVSYS_USER_CHANNEL4_gc 0x05
+#define EVSYS_USER_CHANNEL5_gc 0x06
+#define RSTCTRL_PORF_bm 0x01
+#define RSTCTRL_BORF_bm 0x02
+#define RSTCTRL_EXTRF_bm 0x04
+#define RSTCTRL_WDRF_bm 0x08
+#define RSTCTRL_SWRF_bm 0x10
+#define RSTCTRL_UPDIRF_bm 0x20
+#define MVIO_VDDIO2S_bm 0x01
+#define WDT_PERIOD_8KCLK_gc 0x0B
+#define WDT_WINDOW_8CLK_gc 0x10
+#define USART_RXEN_bm 0x80
+#define USART_TXEN_bm 0x40
+
+#endif // HOST_AVR_IO_H__
@@ -0,0 +1,22 @@
+/**************************************************************************/
+/*!
+  @file     avr/wdt.h
+
+  Arduino K197Display sketch
+
+  Copyright (C) 2022 by ALX2009
+
+  License: MIT (see LICENSE)
+
+  This file is part of the Arduino K197Display sketch, please see
+  https://github.com/alx2009/K197Display for more information
+
+  Host build: there is no watchdog on the host
+*/
+/**************************************************************************/
+#ifndef HOST_AVR_WDT_H__
+#define HOST_AVR_WDT_H__
+
+inline void wdt_reset() {} ///< same as avr-libc, does nothing
+
+#endif // HOST_AVR_WDT_H__
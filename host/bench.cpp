@@ -0,0 +1,137 @@
+/**************************************************************************/
+/*!
+  @file     bench.cpp
+
+  Arduino K197Display sketch
+
+  Copyright (C) 2022 by ALX2009
+
+  License: MIT (see LICENSE)
+
+  This file is part of the Arduino K197Display sketch, please see
+  https://github.com/alx2009/K197Display for more information
+
+  Host build: frame processing benchmark. The frames are replayed through
+  the same path as loop() in K197Display.ino, and the time spent in each
+  stage is reported for each screen mode:
+     - isr: the SPI interrupt handlers receiving the frame
+     - device: K197device::getNewReading() (decode, statistics, graph)
+     - render: UImanager::updateDisplay() (drawing and dirty tile detection)
+     - send: UImanager::pollDisplay() until the update is complete
+  together with the drawing calls, the pixels drawn and the bytes sent to
+  the display for each frame.
+
+  The times are measured on the host, they are useful to compare two versions
+  of the code but they are not AVR cycle counts. The other figures are the
+  same on the AVR.
+
+  Usage: k197bench [-n frames] [log]
+  The frames are synthetic (a slowly changing voltage with noise) unless a
+  log is given: in this case the frames are taken from the lines printed by
+  the "msg" serial command ("SPI - N=9: 0x.. 0x.. ..."), and replayed 3 times
+  per second.
+*/
+/**************************************************************************/
+#include <chrono>
+
+#include "../K197device.h"
+#include "../UImanager.h"
+#include "../debugUtil.h"
+#include "frames.h"
+#include "host.h"
+
+const char CH_SPACE = ' '; ///< defined in K197Display.ino for the sketch
+
+/*!
+      @brief accumulate the time spent in a stage
+*/
+struct stage_timer {
+  std::chrono::steady_clock::time_point t0; ///< start of the stage
+  double ns = 0.0;                          ///< total time
+
+  /*!
+     @brief  start the stage
+  */
+  void start() { t0 = std::chrono::steady_clock::now(); }
+  /*!
+     @brief  stop the stage
+  */
+  void stop() {
+    ns += std::chrono::duration<double, std::nano>(
+              std::chrono::steady_clock::now() - t0)
+              .count();
+  }
+};
+
+/*!
+      @brief replay the frames with a screen mode and print the results
+      @param name the name printed in the report
+      @param mode the screen mode
+      @param cursors true to show the cursors (graph mode only)
+      @param frames the frames to replay
+*/
+static void runScreen(const char *name, K197screenMode mode, bool cursors,
+                      const frame_list &frames) {
+  uiman.setScreenMode(mode);
+  if (cursors != uiman.areCursorsVisible())
+    uiman.toggleCursorsVisibility();
+  k197dev.resetStatistics();
+  stage_timer isr, device, render, send;
+  host_display_stats stats0 = hostDisplayStats;
+  unsigned long bytes = 0UL;
+  byte data[PACKET_DATA];
+  for (const auto &frame : frames) {
+    hostAdvance(333000UL);
+    isr.start();
+    hostReceiveFrame(frame.data(), frame.size());
+    isr.stop();
+    device.start();
+    byte n = k197dev.getNewReading(data);
+    device.stop();
+    if (n != PACKET_DATA)
+      continue;
+    render.start();
+    uiman.updateDisplay();
+    render.stop();
+    send.start();
+    while (!uiman.pollDisplay())
+      ;
+    send.stop();
+    bytes += uiman.getTransferBytes();
+  }
+  double nf = frames.size();
+  printf("%-8s %6u %7.0f %7.0f %7.0f %7.0f %7.1f %7.0f %7.0f\n", name,
+         unsigned(frames.size()), isr.ns / nf, device.ns / nf, render.ns / nf,
+         send.ns / nf, (hostDisplayStats.draw_calls - stats0.draw_calls) / nf,
+         (hostDisplayStats.pixels - stats0.pixels) / nf, bytes / nf);
+}
+
+int main(int argc, char *argv[]) {
+  unsigned nframes = 1000;
+  const char *log = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      nframes = strtoul(argv[++i], NULL, 10);
+    else
+      log = argv[i];
+  }
+  frame_list frames =
+      log ? hostRecordedFrames(log) : hostSyntheticFrames(nframes);
+  if (frames.empty()) {
+    fprintf(stderr, "no frames to replay\n");
+    return 1;
+  }
+
+  DebugOut.begin();
+  k197dev.setup();
+  uiman.setup();
+
+  printf("%-8s %6s %7s %7s %7s %7s %7s %7s %7s\n", "screen", "frames", "isr",
+         "device", "render", "send", "draws", "pixels", "bytes");
+  printf("%-8s %6s %31s %23s\n", "", "", "(ns/frame, host)", "(per frame)");
+  runScreen("normal", K197sc_normal, false, frames);
+  runScreen("stat", K197sc_minmax, false, frames);
+  runScreen("graph", K197sc_graph, false, frames);
+  runScreen("cursors", K197sc_graph, true, frames);
+  return 0;
+}
@@ -0,0 +1,118 @@
+/**************************************************************************/
+/*!
+  @file     frames.cpp
+
+  Arduino K197Display sketch
+
+  Copyright (C) 2022 by ALX2009
+
+  License: MIT (see LICENSE)
+
+  This file is part of the Arduino K197Display sketch, please see
+  https://github.com/alx2009/K197Display for more information
+
+  Host build: frames sent by the K197, see frames.h
+*/
+/**************************************************************************/
+#include "frames.h"
+#include "../K197device.h"
+
+/// the segments of the digits 0 to 9, see seg2char in K197device.cpp
+static const byte digit_seg[10] = {0x77, 0x60, 0x3e, 0x7c, 0x69,
+                                   0x5d, 0x5f, 0x64, 0x7f, 0x6d};
+
+/*!
+      @brief the byte sent by the K197 for a character
+      @param c the character, a digit or a space
+      @param dp true if the decimal point must be on
+      @return the byte sent by the K197 for the character
+*/
+static byte char2seg(char c, bool dp) {
+  byte s = isdigit(c) ? digit_seg[c - '0'] : 0x00;
+  return ((s & 0b01111100) << 1) | (s & 0b00000011) | (dp ? 0b00000100 : 0);
+}
+
+/*!
+      @brief build a frame
+      @param msg the message shown by the K197: an optional '-', up to 6
+   digits or spaces and an optional decimal point (e.g. " 1.2345")
+      @param annunciators0 MINUS BAT RCL AC dB STO REL AUTO (MINUS is set by
+   msg)
+      @param annunciators7 mA, k, V, u (micro), M, m (mV)
+      @param annunciators8 RMT, A, Omega (Ohm), C
+      @return the frame
+*/
+frame_type hostMakeFrame(const char *msg, byte annunciators0,
+                         byte annunciators7, byte annunciators8) {
+  frame_type data(PACKET_DATA, 0);
+  data[0] = annunciators0;
+  if (*msg == '-') {
+    data[0] |= K197_MINUS_bm;
+    msg++;
+  }
+  byte i = 1;
+  bool dp = false;
+  for (; *msg != 0 && i < 7; msg++) {
+    if (*msg == '.') {
+      dp = true;
+    } else {
+      data[i++] = char2seg(*msg, dp);
+      dp = false;
+    }
+  }
+  data[7] = annunciators7;
+  data[8] = annunciators8;
+  return data;
+}
+
+/*!
+      @brief build a sequence of measurements on the 2V DC range
+      @details a slowly changing voltage, with random noise if required (the
+   noise is the same in every run, see random())
+      @param n the number of frames
+      @param noise true to add the noise
+      @return the frames
+*/
+frame_list hostSyntheticFrames(unsigned n, bool noise) {
+  frame_list frames;
+  for (unsigned i = 0; i < n; i++) {
+    double value = 1.2 + 0.6 * sin(i * 0.05);
+    if (noise)
+      value += random(-500, 500) * 1e-5;
+    char msg[16];
+    snprintf(msg, sizeof(msg), "%7.4f", value);
+    frames.push_back(hostMakeFrame(msg, K197_AUTO_bm, K197_V_bm));
+  }
+  return frames;
+}
+
+/*!
+      @brief read the frames printed by the "msg" serial command
+      @details the lines look like "SPI - N=9: 0x.. 0x.. ...", other lines are
+   ignored
+      @param path the log file
+      @return the frames (empty if the file could not be read)
+*/
+frame_list hostRecordedFrames(const char *path) {
+  frame_list frames;
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    perror(path);
+    return frames;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), f) != NULL) {
+    const char *p = strstr(line, "SPI - N=9:");
+    if (p == NULL)
+      continue;
+    frame_type data;
+    while ((p = strstr(p, "0x")) != NULL && data.size() < PACKET_DATA) {
+      data.push_back(strtoul(p + 2, NULL, 16));
+      p += 2;
+    }
+    if (data.size() == PACKET_DATA)
+      frames.push_back(data);
+  }
+  fclose(f);
+  return frames;
+}
@@ -0,0 +1,31 @@
+/**************************************************************************/
+/*!
+  @file     frames.h
+
+  Arduino K197Display sketch
+
+  Copyright (C) 2022 by ALX2009
+
+  License: MIT (see LICENSE)
+
+  This file is part of the Arduino K197Display sketch, please see
+  https://github.com/alx2009/K197Display for more information
+
+  Host build: frames sent by the K197, used by the host programs (bench.cpp,
+  screens.cpp) with hostReceiveFrame()
+*/
+/**************************************************************************/
+#ifndef HOST_FRAMES_H__
+#define HOST_FRAMES_H__
+#include <Arduino.h>
+#include <vector>
+
+typedef std::vector<byte> frame_type;       ///< the data bytes of a frame
+typedef std::vector<frame_type> frame_list; ///< the frames to replay
+
+frame_type hostMakeFrame(const char *msg, byte annunciators0,
+                         byte annunciators7, byte annunciators8 = 0x00);
+frame_list hostSyntheticFrames(unsigned n, bool noise = true);
+frame_list hostRecordedFrames(const char *path);
+
+#endif // HOST_FRAMES_H__
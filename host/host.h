@@ -0,0 +1,41 @@
+/**************************************************************************/
+/*!
+  @file     host.h
+
+  Arduino K197Display sketch
+
+  Copyright (C) 2022 by ALX2009
+
+  License: MIT (see LICENSE)
+
+  This file is part of the Arduino K197Display sketch, please see
+  https://github.com/alx2009/K197Display for more information
+
+  Host build: functions used by the host programs (bench.cpp, screens.cpp)
+  to drive the sketch code in place of the hardware.
+
+  Time is simulated: millis() and micros() only change when the harness calls
+  hostAdvance() (or the sketch calls delay()), so a run is repeatable. Time
+  measurements must use the host clock (e.g. std::chrono) instead.
+*/
+/**************************************************************************/
+#ifndef HOST_H__
+#define HOST_H__
+#include <Arduino.h>
+
+void hostAdvance(unsigned long us);
+void hostReceiveFrame(const byte *data, byte n);
+
+/*!
+    @brief  counters updated by the host u8g2 (U8g2lib.h)
+*/
+struct host_display_stats {
+  unsigned long draw_calls = 0UL; ///< drawing functions called
+  unsigned long pixels = 0UL;     ///< pixels written in the buffer
+  unsigned long tiles_sent = 0UL; ///< 8x8 tiles sent to the display
+};
+extern host_display_stats hostDisplayStats; ///< display counters
+
+const uint8_t *hostDisplayRam();
+
+#endif // HOST_H__
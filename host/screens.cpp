@@ -0,0 +1,312 @@
+/**************************************************************************/
+/*!
+  @file     screens.cpp
+
+  Arduino K197Display sketch
+
+  Copyright (C) 2022 by ALX2009
+
+  License: MIT (see LICENSE)
+
+  This file is part of the Arduino K197Display sketch, please see
+  https://github.com/alx2009/K197Display for more information
+
+  Host build: screen regression test. Each screen is rendered from a scripted
+  sequence of K197 frames and UI actions, compared with a reference image and
+  its render cost is reported:
+     - render: UImanager::updateDisplay() time (ns/frame, host)
+     - draws, pixels: drawing calls and pixels drawn per frame
+     - bytes: bytes sent to the display per frame
+
+  The references are the PBM images printed by UImanager::printScreen() (the
+  same as the "scr" serial command), in extras/screens/host. The host u8g2
+  draws all the fonts with a scaled 5x7 glyph, so the references only match
+  the host build: they catch any change in what the screen functions draw,
+  but they are not pictures of the OLED (see extras/screens/README.md).
+
+  Usage: k197screens [--record] [-o dir] refdir
+     --record  save the screens as the new references in refdir
+     -o dir    save the screens that do not match in dir
+  The exit status is 1 if any screen does not match its reference.
+*/
+/**************************************************************************/
+#include <chrono>
+#include <string>
+
+#include "../K197device.h"
+#include "../UImanager.h"
+#include "../debugUtil.h"
+#include "frames.h"
+#include "host.h"
+
+const char CH_SPACE = ' '; ///< defined in K197Display.ino for the sketch
+
+/*!
+      @brief Print to a string, used to capture printScreen()
+*/
+class StringPrint : public Print {
+public:
+  std::string text; ///< what has been printed so far
+  /*!
+     @brief  print a character
+     @param c the character
+     @return 1
+  */
+  size_t write(uint8_t c) override {
+    if (c != '\r')
+      text += char(c);
+    return 1;
+  }
+  using Print::write;
+};
+
+/*!
+      @brief a screen to check
+*/
+struct screen_type {
+  const char *name; ///< name of the reference, without .pbm
+  void (*setup)();  ///< called after the first half of the frames
+  bool tk;          ///< true to send mV frames (the others are 2V DC)
+};
+
+static void setupMain() {}
+static void setupStat() { uiman.setScreenMode(K197sc_minmax); }
+static void setupGraph() { uiman.setScreenMode(K197sc_graph); }
+static void setupCursors() {
+  uiman.setScreenMode(K197sc_graph);
+  uiman.toggleCursorsVisibility();
+  uiman.setCursorPosition(UImanager::CURSOR_A, 40);
+  uiman.setCursorPosition(UImanager::CURSOR_B, 120);
+}
+static void setupHold() {
+  uiman.setScreenMode(K197sc_graph);
+  k197dev.setDisplayHold(true);
+}
+static void setupTK() { k197dev.setTKMode(true); }
+static void setupMenu() { uiman.showOptionsMenu(); }
+
+/// the screens to check, in this order
+static const screen_type screens[] = {
+    {"main", setupMain, false},   {"stat", setupStat, false},
+    {"graph", setupGraph, false}, {"cursors", setupCursors, false},
+    {"hold", setupHold, false},   {"tk", setupTK, true},
+    {"menu", setupMenu, false},
+};
+
+/*!
+      @brief get the pixels of a plain PBM image
+      @param text the image
+      @return the pixels, one '0' or '1' character each (empty if the header
+   is not P1 256x64)
+*/
+static std::string pbmPixels(const std::string &text) {
+  std::string pixels;
+  int w = 0, h = 0;
+  if (sscanf(text.c_str(), "P1 %d %d", &w, &h) != 2 || w != 256 || h != 64)
+    return pixels;
+  size_t start = text.find('\n', text.find('\n') + 1);
+  for (size_t i = start; i < text.size(); i++) {
+    if (text[i] == '0' || text[i] == '1')
+      pixels += text[i];
+  }
+  return pixels;
+}
+
+/*!
+      @brief read a file
+      @param path the file
+      @param text returns the content
+      @return true if the file could be read
+*/
+static bool readFile(const std::string &path, std::string *text) {
+  FILE *f = fopen(path.c_str(), "r");
+  if (f == NULL)
+    return false;
+  char buf[1024];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    text->append(buf, n);
+  fclose(f);
+  return true;
+}
+
+/*!
+      @brief write a file
+      @param path the file
+      @param text the content
+      @return true if the file could be written
+*/
+static bool writeFile(const std::string &path, const std::string &text) {
+  FILE *f = fopen(path.c_str(), "w");
+  if (f == NULL) {
+    perror(path.c_str());
+    return false;
+  }
+  bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+  return fclose(f) == 0 && ok;
+}
+
+/*!
+      @brief compare an image with its reference
+      @param image the image
+      @param ref the reference
+      @param result returns a description of the differences
+      @return true if the images are the same
+*/
+static bool compare(const std::string &image, const std::string &ref,
+                    char *result) {
+  std::string a = pbmPixels(image);
+  std::string b = pbmPixels(ref);
+  if (b.size() != a.size()) {
+    strcpy(result, "bad reference");
+    return false;
+  }
+  int n = 0, x0 = 256, y0 = 64, x1 = -1, y1 = -1;
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i] == b[i])
+      continue;
+    int x = i % 256, y = i / 256;
+    n++;
+    x0 = x < x0 ? x : x0;
+    y0 = y < y0 ? y : y0;
+    x1 = x > x1 ? x : x1;
+    y1 = y > y1 ? y : y1;
+  }
+  if (n == 0) {
+    strcpy(result, "ok");
+    return true;
+  }
+  sprintf(result, "DIFF %d pixels in (%d,%d)-(%d,%d)", n, x0, y0, x1, y1);
+  return false;
+}
+
+/*!
+      @brief bring the UI and the device to the same state before each screen
+*/
+static void resetState() {
+  k197dev.setDisplayHold(false);
+  k197dev.setTKMode(false);
+  uiman.showFullScreen();
+  uiman.setScreenMode(K197sc_normal);
+  k197dev.resetStatistics();
+}
+
+/*!
+      @brief render a screen and check it
+      @param screen the screen
+      @param frames the frames to replay
+      @param refdir the directory of the references
+      @param record true to save the screen as the new reference
+      @param outdir if not NULL, where to save the screen if it does not match
+      @return true if the screen matches the reference (or has been recorded)
+*/
+static bool checkScreen(const screen_type &screen, const frame_list &frames,
+                        const std::string &refdir, bool record,
+                        const char *outdir) {
+  resetState();
+  double render_ns = 0.0;
+  unsigned long bytes = 0UL;
+  unsigned nframes = 0;
+  host_display_stats stats0 = hostDisplayStats;
+  byte data[PACKET_DATA];
+  for (size_t i = 0; i < frames.size(); i++) {
+    if (i == frames.size() / 2) {
+      screen.setup();
+      render_ns = 0.0;
+      bytes = 0UL;
+      nframes = 0;
+      stats0 = hostDisplayStats;
+    }
+    hostAdvance(333000UL);
+    hostReceiveFrame(frames[i].data(), frames[i].size());
+    if (k197dev.getNewReading(data) != PACKET_DATA)
+      continue;
+    auto t0 = std::chrono::steady_clock::now();
+    uiman.updateDisplay();
+    render_ns += std::chrono::duration<double, std::nano>(
+                     std::chrono::steady_clock::now() - t0)
+                     .count();
+    uiman.flushDisplay();
+    bytes += uiman.getTransferBytes();
+    nframes++;
+  }
+
+  StringPrint image;
+  uiman.printScreen(image);
+  std::string path = refdir + "/" + screen.name + ".pbm";
+  char result[96];
+  bool ok = true;
+  std::string ref;
+  if (record) {
+    ok = writeFile(path, image.text);
+    strcpy(result, ok ? "recorded" : "not recorded");
+  } else if (!readFile(path, &ref)) {
+    strcpy(result, "no reference");
+    ok = false;
+  } else {
+    ok = compare(image.text, ref, result);
+  }
+  if (!ok && !record && outdir != NULL)
+    writeFile(std::string(outdir) + "/" + screen.name + ".pbm", image.text);
+
+  double nf = nframes > 0 ? nframes : 1;
+  printf("%-8s %6u %7.0f %7.1f %7.0f %7.0f  %s\n", screen.name, nframes,
+         render_ns / nf, (hostDisplayStats.draw_calls - stats0.draw_calls) / nf,
+         (hostDisplayStats.pixels - stats0.pixels) / nf, bytes / nf, result);
+  return ok;
+}
+
+/*!
+      @brief build the frames for the TK screen
+      @details a temperature of a few degrees, on the 200mV DC range
+      @param n the number of frames
+      @return the frames
+*/
+static frame_list tkFrames(unsigned n) {
+  frame_list frames;
+  for (unsigned i = 0; i < n; i++) {
+    char msg[16];
+    snprintf(msg, sizeof(msg), "%7.2f", 0.5 + 0.2 * sin(i * 0.05));
+    frames.push_back(
+        hostMakeFrame(msg, K197_AUTO_bm, K197_V_bm | K197_mV_bm));
+  }
+  return frames;
+}
+
+int main(int argc, char *argv[]) {
+  bool record = false;
+  const char *outdir = NULL;
+  const char *refdir = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--record") == 0)
+      record = true;
+    else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+      outdir = argv[++i];
+    else
+      refdir = argv[i];
+  }
+  if (refdir == NULL) {
+    fprintf(stderr, "usage: k197screens [--record] [-o dir] refdir\n");
+    return 2;
+  }
+
+  DebugOut.begin();
+  k197dev.setup();
+  uiman.setup();
+
+  // no noise, so that the screens do not depend on random()
+  const unsigned nframes = 200;
+  frame_list frames = hostSyntheticFrames(nframes, false);
+  frame_list frames_tk = tkFrames(nframes);
+
+  printf("%-8s %6s %7s %7s %7s %7s  %s\n", "screen", "frames", "render",
+         "draws", "pixels", "bytes", "result");
+  printf("%-8s %6s %7s %23s\n", "", "", "(ns)", "(per frame)");
+  bool ok = true;
+  for (const screen_type &screen : screens) {
+    if (!checkScreen(screen, screen.tk ? frames_tk : frames, refdir, record,
+                     outdir))
+      ok = false;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+/**************************************************************************/
+/*!
+  @file     loopStats.cpp
+
+  Arduino K197Display sketch
+
+  Copyright (C) 2022 by ALX2009
+
+  License: MIT (see LICENSE)
+
+  This file is part of the Arduino K197Display sketch, please see
+  https://github.com/alx2009/K197Display for more information
+
+  This file implements the loopStatsClass class, see loopStats.h for the
+  class definition
+
+*/
+/**************************************************************************/
+#include "loopStats.h"
+#include "debugUtil.h"
+#include "pinout.h" // for CH_SPACE
+
+loopStatsClass loopStats;
+
+// Names of the loopWork values, in the same order
+static const char work_name_idle[] PROGMEM = "idle";
+static const char work_name_frame[] PROGMEM = "frame";
+static const char work_name_render[] PROGMEM = "render";
+static const char work_name_log[] PROGMEM = "log";
+static const char work_name_event[] PROGMEM = "event";
+static const char *const work_names[loop_work_types] PROGMEM = {
+    work_name_idle, work_name_frame, work_name_render, work_name_log,
+    work_name_event}; ///< names of the loopWork values
+
+/*!
+      @brief utility function, find the bucket for a loop time
+      @param t the loop time in microseconds
+      @return the bucket index
+*/
+byte loopStatsClass::bucket(unsigned long t) {
+  byte b = 0;
+  for (t >>= 7; t != 0 && b < num_buckets - 1; t >>= 1)
+    b++;
+  return b;
+}
+
+/*!
+      @brief utility function, the end of a bucket
+      @param b the bucket index, must be less than num_buckets - 1 (the last
+   bucket has no end)
+      @return the smallest loop time that does not fit in the bucket (us)
+*/
+unsigned long loopStatsClass::bucketEnd(byte b) { return 128UL << b; }
+
+/*!
+      @brief add a loop time to the histogram
+      @details when a counter is full, all the counters are halved. The
+   histogram then gives more weight to the recent loops, but the percentiles
+   are still meaningful
+      @param work what happened during the loop
+      @param t the loop time in microseconds
+*/
+void loopStatsClass::add(loopWork work, unsigned long t) {
+  if (work >= loop_work_types)
+    return;
+  byte b = bucket(t);
+  if (hist[work][b] == 0xffff) {
+    for (byte w = 0; w < loop_work_types; w++)
+      for (byte i = 0; i < num_buckets; i++)
+        hist[w][i] /= 2;
+  }
+  hist[work][b]++;
+  if (t > tmax[work])
+    tmax[work] = t;
+}
+
+/*!
+      @brief reset the histogram
+*/
+void loopStatsClass::reset() {
+  memset(hist, 0, sizeof(hist));
+  memset(tmax, 0, sizeof(tmax));
+}
+
+/*!
+      @brief estimate a percentile of the loop time
+      @param work the type of work to consider, loop_work_types for all
+      @param pct the percentile (e.g. 95)
+      @return the end of the bucket containing the percentile, or the maximum
+   if lower (us). Zero if the histogram is empty
+*/
+unsigned long loopStatsClass::percentile(byte work, byte pct) {
+  byte w0 = work < loop_work_types ? work : 0;
+  byte w1 = work < loop_work_types ? work + 1 : loop_work_types;
+  unsigned long n = 0UL;
+  unsigned long t = 0UL;
+  for (byte w = w0; w < w1; w++) {
+    for (byte b = 0; b < num_buckets; b++)
+      n += hist[w][b];
+    if (tmax[w] > t)
+      t = tmax[w];
+  }
+  if (n == 0)
+    return 0UL;
+  unsigned long target = (n * pct + 99UL) / 100UL; // rounded up
+  unsigned long cumulative = 0UL;
+  for (byte b = 0; b < num_buckets - 1; b++) {
+    for (byte w = w0; w < w1; w++)
+      cumulative += hist[w][b];
+    if (cumulative >= target)
+      return bucketEnd(b) < t ? bucketEnd(b) : t;
+  }
+  return t; // in the last bucket
+}
+
+/*!
+      @brief estimate a percentile of the loop time
+      @param pct the percentile (e.g. 95)
+      @return the end of the bucket containing the percentile, or the maximum
+   if lower (us)
+*/
+unsigned long loopStatsClass::getPercentile(byte pct) {
+  return percentile(loop_work_types, pct);
+}
+
+/*!
+      @brief get the maximum loop time
+      @return the maximum loop time since the last reset (us)
+*/
+unsigned long loopStatsClass::getMax() {
+  return percentile(loop_work_types, 100);
+}
+
+/*!
+      @brief print the statistics for each type of work and reset them
+      @details prints the number of loops, p50, p95, p99 and max for each type
+   of work and for all loops, followed by the counts in each bucket for all
+   loops
+      @param out the stream to print to (normally Serial)
+*/
+void loopStatsClass::printSummary(Print &out) {
+  out.println(F("loop: n p50 p95 p99 max (us)"));
+  for (byte w = 0; w <= loop_work_types; w++) {
+    unsigned long n = 0UL;
+    for (byte b = 0; b < num_buckets; b++) {
+      for (byte i = 0; i < loop_work_types; i++)
+        if (w == i || w == loop_work_types)
+          n += hist[i][b];
+    }
+    if (w < loop_work_types)
+      out.print((const __FlashStringHelper *)pgm_read_ptr(&work_names[w]));
+    else
+      out.print(F("all"));
+    out.print(F(": "));
+    out.print(n);
+    out.print(CH_SPACE);
+    out.print(percentile(w, 50));
+    out.print(CH_SPACE);
+    out.print(percentile(w, 95));
+    out.print(CH_SPACE);
+    out.print(percentile(w, 99));
+    out.print(CH_SPACE);
+    out.println(percentile(w, 100));
+  }
+  for (byte b = 0; b < num_buckets; b++) {
+    unsigned long n = 0UL;
+    for (byte w = 0; w < loop_work_types; w++)
+      n += hist[w][b];
+    if (b < num_buckets - 1) {
+      out.print('<');
+      out.print(bucketEnd(b));
+    } else {
+      out.print(F(">="));
+      out.print(bucketEnd(b - 1));
+    }
+    out.print(':');
+    out.print(n);
+    out.print(CH_SPACE);
+  }
+  out.println();
+  reset();
+}
+
+/*!
+      @brief print a one line summary for all loops
+      @param out the stream to print to
+*/
+void loopStatsClass::printLogLine(Print &out) {
+  out.print(F("loop p50="));
+  out.print(getPercentile(50));
+  out.print(F(" p95="));
+  out.print(getPercentile(95));
+  out.print(F(" p99="));
+  out.print(getPercentile(99));
+  out.print(F(" max="));
+  out.println(getMax());
+}
+
+/*!
+      @brief print the summary line to DebugOut if it is time to do so
+      @details when enabled with setLogEnabled(), a line is printed every
+   log_period and the histogram is reset, so that each line describes the
+   loops since the previous one. Should be called from loop()
+      @param now the current time, as returned by millis()
+*/
+void loopStatsClass::checkLog(unsigned long now) {
+  if (!log_enabled || (now - last_log) < log_period)
+    return;
+  printLogLine(DebugOut);
+  reset();
+  last_log = now;
+}
@@ -0,0 +1,90 @@
+/**************************************************************************/
+/*!
+  @file     loopStats.h
+
+  Arduino K197Display sketch
+
+  Copyright (C) 2022 by ALX2009
+
+  License: MIT (see LICENSE)
+
+  This file is part of the Arduino K197Display sketch, please see
+  https://github.com/alx2009/K197Display for more information
+
+  This file defines the loopStatsClass class
+
+  This class keeps a histogram of the time spent in loop(), so that it is
+  possible to see how often the loop gets close to the time budget and not
+  only the worst case
+
+*/
+/**************************************************************************/
+#ifndef LOOPSTATS_H__
+#define LOOPSTATS_H__
+#include <Arduino.h>
+
+/*!
+  @brief what happened during a loop() iteration
+  @details when more than one thing happened, the highest value is used
+*/
+enum loopWork : byte {
+  loop_idle = 0,      ///< nothing in particular
+  loop_frame = 1,     ///< a new frame from the K197 has been processed
+  loop_render = 2,    ///< the display has been updated
+  loop_log = 3,       ///< the display has been updated and data logged
+  loop_event = 4,     ///< a push button event has been handled
+  loop_work_types = 5 ///< number of loopWork values
+};
+
+/**************************************************************************/
+/*!
+    @brief  Loop time histogram
+
+    Loop times are counted in buckets of increasing size: the first bucket is
+   below 128us, each following bucket is twice as large as the previous one
+   and the last bucket is 262ms or more (close to the 300ms after which data
+   from the K197 can be lost). There is one histogram for each type of work
+   done in the loop (see loopWork).
+
+    Percentiles are estimated from the histogram, so they are rounded up to
+   the end of a bucket. The maximum is exact.
+*/
+/**************************************************************************/
+class loopStatsClass {
+public:
+  static const byte num_buckets = 13; ///< number of buckets per histogram
+
+  void add(loopWork work, unsigned long t);
+  void reset();
+  unsigned long getPercentile(byte pct);
+  unsigned long getMax();
+  void printSummary(Print &out);
+  void printLogLine(Print &out);
+
+  /*!
+      @brief  check if a summary line is periodically printed to DebugOut
+      @return true if enabled
+  */
+  bool isLogEnabled() { return log_enabled; };
+  /*!
+      @brief  enable/disable the periodic summary line, see checkLog()
+      @param enable true to enable, false to disable
+  */
+  void setLogEnabled(bool enable) { log_enabled = enable; };
+  void checkLog(unsigned long now);
+
+private:
+  uint16_t hist[loop_work_types][num_buckets]; ///< counts for each work type
+  unsigned long tmax[loop_work_types]; ///< max time for each type of work
+  bool log_enabled = false;            ///< enable checkLog()
+  unsigned long last_log = 0UL;        ///< millis() of the last log line
+  static const unsigned long log_period = 10000UL; ///< log period (ms)
+
+  static byte bucket(unsigned long t);
+  static unsigned long bucketEnd(byte b);
+  unsigned long percentile(byte work, byte pct);
+};
+
+extern loopStatsClass loopStats; ///< Predefined loopStatsClass object to use
+
+#endif // LOOPSTATS_H__